@@ -0,0 +1,19 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sysgrab.h"
+
+// Type for the resource usage of one cgroup, -1 where a value is not available
+typedef SysgrabCgroup CgroupStats;
+
+int find_cgroup_root (char *root, size_t size);
+int get_own_cgroup (char *path, size_t size);
+int read_cgroup_stats (int dirfd, CgroupStats *stats);
+CgroupStats *walk_cgroups (const char *root, size_t *cgroup_count);
+void free_cgroups (CgroupStats *cgroups, size_t cgroup_count);
+
+#endif
@@ -11,9 +11,25 @@ typedef struct {
     char *value;
 } Config;
 
-void generate_config_file (char *config_path);
-void edit_config (char *setting, char *value, char *config_path);
-Config *get_config (size_t *config_count, char *config_path);
+// Type for an rgb color
+typedef struct {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+} Color;
+
+#define CONFIG_FILE_NAME "config.txt"
+#define ART_FILE_NAME "art.txt"
+
+int get_user_resource_path (const char *name, char *path, size_t size);
+int get_user_cache_path (const char *name, char *path, size_t size);
+char *load_cache (const char *name);
+int save_cache (const char *name, const char *contents);
+int save_cache_data (const char *name, const void *data, size_t size);
+char *load_resource (const char *name, char *path, size_t path_size);
+int write_resource (const char *name, const char *contents, char *path, size_t path_size);
+char *edit_config (const char *setting, const char *value, const char *contents, char *config_path, size_t path_size);
+Config *get_config (size_t *config_count, const char *contents);
 void free_config (Config *config, size_t config_count);
 
 #endif
\ No newline at end of file
@@ -6,19 +6,74 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "sysgrab.h"
+#include "io.h"
+#include "cgroup.h"
+
+#define INFO_BUFFER_SIZE 256
+#define PROC_BUFFER_SIZE 4096
+#define PREFETCH_MAX 8
+
+// Datapoints, in SysgrabDataPoint order
 typedef enum {
-    USERNAME,
-    HOSTNAME,
-    OS,
-    ARCHITECTURE,
-    KERNEL,
-    COMPUTER,
-    SHELL,
-    UPTIME,
-    CPU,
-    MEMORY
+    USERNAME = SYSGRAB_USERNAME,
+    HOSTNAME = SYSGRAB_HOSTNAME,
+    OS = SYSGRAB_OS,
+    ARCHITECTURE = SYSGRAB_ARCHITECTURE,
+    KERNEL = SYSGRAB_KERNEL,
+    COMPUTER = SYSGRAB_COMPUTER,
+    SHELL = SYSGRAB_SHELL,
+    TERMINAL = SYSGRAB_TERMINAL,
+    UPTIME = SYSGRAB_UPTIME,
+    CPU = SYSGRAB_CPU,
+    TOPOLOGY = SYSGRAB_TOPOLOGY,
+    MEMORY = SYSGRAB_MEMORY,
+    LOAD = SYSGRAB_LOAD,
+    PRESSURE = SYSGRAB_PRESSURE,
+    CGROUP = SYSGRAB_CGROUP,
+    SENSORS = SYSGRAB_SENSORS,
+    DEVICES = SYSGRAB_DEVICES,
+    DATA_POINT_COUNT = SYSGRAB_DATA_POINT_COUNT
 } DataPoint;
 
-char *get_info (DataPoint dp);
+// Memory components from /proc/meminfo in kB
+typedef SysgrabMemory MemInfo;
+
+// Resources with pressure stall information, in SysgrabPressureResource order
+typedef enum {
+    PRESSURE_CPU = SYSGRAB_PRESSURE_CPU,
+    PRESSURE_MEMORY = SYSGRAB_PRESSURE_MEMORY,
+    PRESSURE_IO = SYSGRAB_PRESSURE_IO,
+    PRESSURE_COUNT = SYSGRAB_PRESSURE_COUNT
+} PressureResource;
+
+// Type for the "some" line of a pressure file
+typedef SysgrabPressure Pressure;
+
+// Type for files read ahead of time in one batch, consulted before reading from disk.
+// Owned by the caller, so separate contexts and threads never share one.
+typedef struct {
+    FileRead reads[PREFETCH_MAX];
+    char buffers[PREFETCH_MAX][PROC_BUFFER_SIZE];
+    size_t count;
+} Prefetch;
+
+int format_info (const Prefetch *prefetch, DataPoint dp, char *buffer, size_t size);
+char *get_info (const Prefetch *prefetch, DataPoint dp);
+IoBackend prefetch_info (Prefetch *prefetch, IoBackend backend, const DataPoint *dps, size_t count);
+void clear_prefetch (Prefetch *prefetch);
+int parse_meminfo (const char *contents, MemInfo *mem);
+int parse_uptime (const char *contents, double *uptime);
+int parse_loadavg (const char *contents, double load[3]);
+int parse_pressure (const char *contents, Pressure *pressure);
+int read_meminfo (const Prefetch *prefetch, MemInfo *mem);
+int read_uptime (const Prefetch *prefetch, double *uptime);
+int read_loadavg (const Prefetch *prefetch, double load[3]);
+int read_pressure (const Prefetch *prefetch, PressureResource resource, Pressure *pressure);
+int format_uptime (double uptime, char *buffer, size_t size);
+int format_memory (const MemInfo *mem, char *buffer, size_t size);
+int format_load (const double load[3], char *buffer, size_t size);
+int format_pressure (const Pressure pressure[PRESSURE_COUNT], char *buffer, size_t size);
+int format_cgroup (const CgroupStats *stats, char *buffer, size_t size);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+
+// Type for the per-CPU state kept open between refreshes
+typedef struct {
+    int cpu_count;
+    int *cpus;
+    int *freq_fds;
+    long *max_freq;
+    long *cur_freq;
+    unsigned long long *prev_busy;
+    unsigned long long *prev_total;
+    double *util;
+    int *slot_of_cpu;
+    int max_cpu;
+    int stat_fd;
+    char *stat_buffer;
+    size_t stat_size;
+} Heatmap;
+
+Heatmap *open_heatmap (void);
+int sample_heatmap (Heatmap *heatmap);
+char *render_heatmap (const Heatmap *heatmap, const Color *base_color, const Color *accent_color);
+void close_heatmap (Heatmap *heatmap);
+
+#endif
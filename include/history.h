@@ -0,0 +1,57 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "sysgrab.h"
+#include "data.h"
+
+// Fields stored in every history sample
+typedef enum {
+    HIST_TIME,
+    HIST_UPTIME,
+    HIST_MEM_TOTAL,
+    HIST_MEM_FREE,
+    HIST_MEM_BUFFERS,
+    HIST_MEM_CACHED,
+    HIST_MEM_SHMEM,
+    HIST_MEM_SRECLAIMABLE,
+    HIST_SWAP_TOTAL,
+    HIST_SWAP_FREE,
+    HIST_LOAD_1,
+    HIST_LOAD_5,
+    HIST_LOAD_15,
+    HIST_PRESSURE_CPU,
+    HIST_PRESSURE_MEMORY,
+    HIST_PRESSURE_IO,
+    HISTORY_FIELD_COUNT
+} HistoryField;
+
+// Type for one sample, times in seconds, memory in kB, load averages * 100 and
+// 10 second pressure averages in percent * 100
+typedef struct {
+    int64_t values[HISTORY_FIELD_COUNT];
+} Sample;
+
+// Type for the min, max and average of a series
+typedef struct {
+    double min;
+    double max;
+    double avg;
+} Summary;
+
+typedef struct History History;
+
+History *open_history (const char *history_path, bool create);
+void close_history (History *history);
+int collect_sample (Sysgrab *sysgrab, Sample *sample);
+int append_sample (History *history, const Sample *sample);
+Sample *read_samples (History *history, size_t *sample_count);
+void summarize (const double *values, size_t count, Summary *summary);
+char *make_sparkline (const double *values, size_t count, size_t width);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef IO_H
+#define IO_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sysgrab.h"
+
+// Backends used to read batches of small files, in SysgrabBackend order
+typedef enum {
+    IO_SYNC = SYSGRAB_IO_SYNC,
+    IO_URING = SYSGRAB_IO_URING
+} IoBackend;
+
+// Type for one file read in a batch
+typedef struct {
+    const char *path;
+    char *buffer;
+    size_t size;
+    ssize_t len;
+} FileRead;
+
+ssize_t read_file_buffer (const char *file_path, char *buffer, size_t size);
+ssize_t read_file_at (int dirfd, const char *file_path, char *buffer, size_t size);
+IoBackend read_files (FileRead *reads, size_t count, IoBackend backend);
+void read_files_sync (FileRead *reads, size_t count);
+int read_files_uring (FileRead *reads, size_t count);
+unsigned long get_syscall_count (void);
+void count_syscalls (unsigned long count);
+
+#endif
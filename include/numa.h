@@ -0,0 +1,20 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Type for the memory of one NUMA node, sizes in kB
+typedef struct {
+    int node;
+    long total;
+    long free;
+    long file_pages;
+    long huge_total;
+    long huge_free;
+} NodeMemInfo;
+
+NodeMemInfo *read_numa_nodes (size_t *node_count);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef PAINT_H
+#define PAINT_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "config.h"
+
+#define PAINT_ESCAPE_SIZE 20
+#define PAINT_CHAR_COUNT 128
+#define PAINT_NO_COLOR UINT32_MAX
+
+// Escape sequences the terminal understands, truecolor unless configured otherwise
+typedef enum {
+    COLOR_TRUECOLOR,
+    COLOR_256,
+    COLOR_AUTO
+} ColorMode;
+
+// Directions the art color can change in
+typedef enum {
+    GRADIENT_NONE,
+    GRADIENT_VERTICAL,
+    GRADIENT_HORIZONTAL,
+    GRADIENT_DIAGONAL
+} Gradient;
+
+// Type for the art coloring settings, the gradient starts at the accent color
+typedef struct {
+    ColorMode mode;
+    Gradient gradient;
+    Color end;
+    bool has_char_color[PAINT_CHAR_COUNT];
+    Color char_colors[PAINT_CHAR_COUNT];
+} ArtStyle;
+
+// Type for a precomputed escape, the key is equal for escapes that look the same
+typedef struct {
+    uint32_t key;
+    uint8_t length;
+    char escape[PAINT_ESCAPE_SIZE];
+} PaintColor;
+
+// Type for the color table of one art size, built once and reused for every line
+typedef struct {
+    ColorMode mode;
+    Gradient gradient;
+    size_t width;
+    size_t height;
+    size_t steps;
+    PaintColor *table;
+    bool has_char_color[PAINT_CHAR_COUNT];
+    PaintColor char_colors[PAINT_CHAR_COUNT];
+} ArtPaint;
+
+ColorMode resolve_color_mode (ColorMode mode);
+void make_paint_color (const Color *color, ColorMode mode, PaintColor *paint_color);
+size_t write_paint_color (char *output, const PaintColor *paint_color, uint32_t *current);
+int parse_art_style (const char *name, const char *value, ArtStyle *style);
+ArtPaint *create_art_paint (const ArtStyle *style, const Color *accent_color, size_t width, size_t height);
+size_t paint_art_line (const ArtPaint *paint, const char *line, size_t row, char *output, uint32_t *current);
+void free_art_paint (ArtPaint *paint);
+
+#endif
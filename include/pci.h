@@ -0,0 +1,62 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_PCI_DEVICES 64
+#define PCI_VENDOR_KEY 0xFFFF
+
+// Base classes of the devices that are listed
+#define PCI_CLASS_NETWORK 0x02
+#define PCI_CLASS_DISPLAY 0x03
+
+// Type for a listed PCI function
+typedef struct {
+    uint16_t vendor;
+    uint16_t device;
+    uint32_t class;
+} PciDevice;
+
+// Type for one name in the index, keyed by vendor and device, or by vendor and
+// PCI_VENDOR_KEY for the vendor itself
+typedef struct {
+    uint32_t key;
+    uint32_t name;
+} PciIndexEntry;
+
+// Type for the header of the cached index, which records the pci.ids file it
+// was built from. The sorted entries and the name pool follow it.
+typedef struct {
+    char magic[8];
+    uint64_t source_dev;
+    uint64_t source_ino;
+    uint64_t source_size;
+    int64_t source_mtime;
+    int64_t source_mtime_nsec;
+    uint32_t entry_count;
+    uint32_t names_size;
+} PciIndexHeader;
+
+// Type for a loaded index, either mapped from the cache or built in memory
+typedef struct {
+    void *data;
+    size_t size;
+    bool mapped;
+    const PciIndexEntry *entries;
+    uint32_t entry_count;
+    const char *names;
+    uint32_t names_size;
+} PciIds;
+
+size_t list_pci_devices (PciDevice *devices, size_t max_devices);
+PciIds *load_pci_ids (const char *path);
+PciIds *open_pci_ids (void);
+const char *find_pci_name (const PciIds *ids, uint16_t vendor, uint16_t device);
+void close_pci_ids (PciIds *ids);
+int format_pci_devices (const PciDevice *devices, size_t count, const PciIds *ids, char *buffer, size_t size);
+
+#endif
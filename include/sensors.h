@@ -0,0 +1,44 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sysgrab.h"
+
+#define MAX_SENSORS SYSGRAB_MAX_SENSORS
+#define SENSOR_PATH_SIZE 96
+
+// Kinds of readings, in SysgrabSensorKind order
+typedef enum {
+    SENSOR_CPU_TEMP = SYSGRAB_SENSOR_CPU_TEMP,
+    SENSOR_DRIVE_TEMP = SYSGRAB_SENSOR_DRIVE_TEMP,
+    SENSOR_FAN = SYSGRAB_SENSOR_FAN,
+    SENSOR_POWER = SYSGRAB_SENSOR_POWER,
+    SENSOR_KIND_COUNT = SYSGRAB_SENSOR_KIND_COUNT
+} SensorKind;
+
+// Type for a discovered hwmon input file
+typedef struct {
+    SensorKind kind;
+    char path[SENSOR_PATH_SIZE];
+} SensorInput;
+
+// Type for a sensor value, in °C, RPM or W
+typedef SysgrabSensorReading SensorReading;
+
+// Type for the resolved inputs, kept open so samples are a single pread each
+typedef struct {
+    SensorInput inputs[MAX_SENSORS];
+    int fds[MAX_SENSORS];
+    size_t count;
+} Sensors;
+
+int open_sensors (Sensors *sensors);
+int sample_sensors (const Sensors *sensors, SensorReading *readings, size_t size);
+void close_sensors (Sensors *sensors);
+int read_sensors (SensorReading *readings, size_t size);
+int format_sensors (const SensorReading *readings, size_t count, char *buffer, size_t size);
+
+#endif
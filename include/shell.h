@@ -0,0 +1,22 @@
+#ifndef SHELL_H
+#define SHELL_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define SHELL_NAME_SIZE 32
+#define SHELL_VERSION_SIZE 48
+
+// Type for the shell sysgrab was started from
+typedef struct {
+    char name[SHELL_NAME_SIZE];
+    char version[SHELL_VERSION_SIZE];
+} ShellInfo;
+
+int detect_shell (ShellInfo *shell);
+int detect_terminal (char *name, size_t size);
+int find_shell_version (const char *data, size_t size, char *version, size_t version_size);
+
+#endif
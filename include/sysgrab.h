@@ -0,0 +1,135 @@
+#ifndef SYSGRAB_H
+#define SYSGRAB_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The only header installed with the library. Every public name starts with
+// sysgrab_, Sysgrab or SYSGRAB_, and every other symbol stays inside the library.
+#define SYSGRAB_API __attribute__((visibility("default")))
+
+#define SYSGRAB_MAX_SENSORS 16
+
+// Datapoints that can be requested as strings
+typedef enum {
+    SYSGRAB_USERNAME,
+    SYSGRAB_HOSTNAME,
+    SYSGRAB_OS,
+    SYSGRAB_ARCHITECTURE,
+    SYSGRAB_KERNEL,
+    SYSGRAB_COMPUTER,
+    SYSGRAB_SHELL,
+    SYSGRAB_TERMINAL,
+    SYSGRAB_UPTIME,
+    SYSGRAB_CPU,
+    SYSGRAB_TOPOLOGY,
+    SYSGRAB_MEMORY,
+    SYSGRAB_LOAD,
+    SYSGRAB_PRESSURE,
+    SYSGRAB_CGROUP,
+    SYSGRAB_SENSORS,
+    SYSGRAB_DEVICES,
+    SYSGRAB_DATA_POINT_COUNT
+} SysgrabDataPoint;
+
+// Backends used to read batches of small files
+typedef enum {
+    SYSGRAB_IO_SYNC,
+    SYSGRAB_IO_URING
+} SysgrabBackend;
+
+// Memory components from /proc/meminfo in kB
+typedef struct {
+    long total;
+    long free;
+    long buffers;
+    long cached;
+    long shmem;
+    long sreclaimable;
+    long swap_total;
+    long swap_free;
+    long huge_total;
+    long huge_free;
+    long huge_rsvd;
+    long huge_size;
+} SysgrabMemory;
+
+// Resources with pressure stall information under /proc/pressure
+typedef enum {
+    SYSGRAB_PRESSURE_CPU,
+    SYSGRAB_PRESSURE_MEMORY,
+    SYSGRAB_PRESSURE_IO,
+    SYSGRAB_PRESSURE_COUNT
+} SysgrabPressureResource;
+
+// Type for the "some" line of a pressure file, averages in percent and the total
+// stall time in microseconds. Averages are negative where pressure is not available.
+typedef struct {
+    double avg10;
+    double avg60;
+    double avg300;
+    unsigned long long total;
+} SysgrabPressure;
+
+// Type for the resource usage of one cgroup, -1 where a value is not available
+typedef struct {
+    char *path;
+    long long memory_current;
+    long long memory_max;
+    long long cpu_usage_usec;
+} SysgrabCgroup;
+
+// Kinds of hwmon sensor readings
+typedef enum {
+    SYSGRAB_SENSOR_CPU_TEMP,
+    SYSGRAB_SENSOR_DRIVE_TEMP,
+    SYSGRAB_SENSOR_FAN,
+    SYSGRAB_SENSOR_POWER,
+    SYSGRAB_SENSOR_KIND_COUNT
+} SysgrabSensorKind;
+
+// Type for a sensor value, in °C, RPM or W
+typedef struct {
+    SysgrabSensorKind kind;
+    double value;
+} SysgrabSensorReading;
+
+// Type for the CPU layout of the machine
+typedef struct {
+    int sockets;
+    int cores;
+    int threads;
+    int numa_nodes;
+    int cache_level;
+    long cache_size_kib;
+    int cache_instances;
+} SysgrabTopology;
+
+// Type for a collection context. Descriptors are opened once on first use, values
+// that cannot change while running are read once, and everything else is reread at
+// most once per refresh, so sampling repeatedly in one process does not allocate.
+// Nothing is shared between contexts, so each one can be used from its own thread.
+typedef struct Sysgrab Sysgrab;
+
+SYSGRAB_API Sysgrab *sysgrab_open (void);
+SYSGRAB_API void sysgrab_refresh (Sysgrab *sysgrab);
+SYSGRAB_API void sysgrab_close (Sysgrab *sysgrab);
+SYSGRAB_API void sysgrab_set_backend (Sysgrab *sysgrab, SysgrabBackend backend);
+SYSGRAB_API void sysgrab_prefetch (Sysgrab *sysgrab, const SysgrabDataPoint *dps, size_t count);
+SYSGRAB_API int sysgrab_get_uptime (Sysgrab *sysgrab, double *uptime);
+SYSGRAB_API int sysgrab_get_memory (Sysgrab *sysgrab, SysgrabMemory *mem);
+SYSGRAB_API int sysgrab_get_load (Sysgrab *sysgrab, double load[3]);
+SYSGRAB_API int sysgrab_get_pressure (Sysgrab *sysgrab, SysgrabPressure pressure[SYSGRAB_PRESSURE_COUNT]);
+SYSGRAB_API int sysgrab_get_cgroup (Sysgrab *sysgrab, SysgrabCgroup *stats);
+SYSGRAB_API int sysgrab_get_sensors (Sysgrab *sysgrab, const SysgrabSensorReading **readings);
+SYSGRAB_API int sysgrab_get_topology (Sysgrab *sysgrab, SysgrabTopology *topology);
+SYSGRAB_API const char *sysgrab_get_string (Sysgrab *sysgrab, SysgrabDataPoint dp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
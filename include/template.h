@@ -0,0 +1,49 @@
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+#include "sysgrab.h"
+#include "data.h"
+#include "paint.h"
+
+// Operations a template line is compiled into
+typedef enum {
+    OP_LITERAL,
+    OP_ACCENT_COLOR,
+    OP_BASE_COLOR,
+    OP_RESET,
+    OP_FIELD,
+    OP_DASHES,
+    OP_END_LINE
+} TemplateOpCode;
+
+// Type for one operation, literals are spans of the template's literal pool
+typedef struct {
+    uint8_t code;
+    uint8_t field;
+    uint16_t length;
+    uint32_t offset;
+} TemplateOp;
+
+// Type for a compiled output layout
+typedef struct {
+    TemplateOp *ops;
+    size_t op_count;
+    char *literals;
+    size_t literals_size;
+    size_t line_count;
+    uint32_t fields;
+} Template;
+
+Template *compile_template (const char **lines, size_t line_count);
+Template *compile_config_template (const Config *config, size_t config_count);
+void free_template (Template *template);
+char *render_template (const Template *template, Sysgrab *sysgrab, const Color *base_color, const Color *accent_color,
+                       char **art, size_t art_line_count, const ArtPaint *paint);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sysgrab.h"
+
+#define CPUSET_WORDS 128
+#define CPUSET_MAX_CPUS (CPUSET_WORDS * 64)
+
+// Type for a bitmap of CPU numbers
+typedef struct {
+    uint64_t bits[CPUSET_WORDS];
+} CpuSet;
+
+// Type for the CPU layout of the machine
+typedef SysgrabTopology Topology;
+
+int parse_cpulist (const char *list, CpuSet *set);
+int parse_cpumask (const char *mask, CpuSet *set);
+int cpuset_count (const CpuSet *set);
+int cpuset_next (const CpuSet *set, int cpu);
+int read_topology (Topology *topology);
+int format_topology (const Topology *topology, char *buffer, size_t size);
+
+#endif
@@ -0,0 +1,297 @@
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "cgroup.h"
+#include "io.h"
+
+#define CGROUP_BUFFER_SIZE 1024
+#define CGROUP_MAX_THREADS 8
+
+// Type for a growable list of walked cgroups
+typedef struct {
+    CgroupStats *items;
+    size_t count;
+    size_t capacity;
+} CgroupList;
+
+// Type for the subtrees shared between walker threads
+typedef struct {
+    int root_fd;
+    char **paths;
+    size_t count;
+    size_t capacity;
+    atomic_size_t next;
+} SubtreeQueue;
+
+// Type for the arguments of one walker thread
+typedef struct {
+    SubtreeQueue *queue;
+    CgroupList results;
+} Walker;
+
+// Function to find where the cgroup v2 hierarchy is mounted
+int find_cgroup_root (char *root, size_t size)
+{
+    const char *candidates[] = {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"};
+    char path[PATH_MAX];
+
+    // Only the unified hierarchy has a cgroup.controllers file at its root
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        snprintf(path, sizeof(path), "%s/cgroup.controllers", candidates[i]);
+        if (access(path, F_OK) == 0) {
+            snprintf(root, size, "%s", candidates[i]);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Function to get the cgroup v2 path of the current process
+int get_own_cgroup (char *path, size_t size)
+{
+    char buffer[CGROUP_BUFFER_SIZE];
+    if (read_file_buffer("/proc/self/cgroup", buffer, sizeof(buffer)) < 0) {
+        return -1;
+    }
+
+    // The unified hierarchy is the line with id 0 and no controllers
+    char *line = buffer;
+    while (line && *line) {
+        if (strncmp(line, "0::", 3) == 0) {
+            line += 3;
+            line[strcspn(line, "\n")] = '\0';
+            snprintf(path, size, "%s", line);
+            return 0;
+        }
+        line = strchr(line, '\n');
+        if (line) {
+            line++;
+        }
+    }
+    return -1;
+}
+
+// Function to read a single number file, treating "max" as unlimited
+static long long read_cgroup_value (int dirfd, const char *name)
+{
+    char buffer[64];
+    if (read_file_at(dirfd, name, buffer, sizeof(buffer)) <= 0 || strncmp(buffer, "max", 3) == 0) {
+        return -1;
+    }
+    return strtoll(buffer, NULL, 10);
+}
+
+// Function to read memory and CPU usage from an open cgroup directory
+int read_cgroup_stats (int dirfd, CgroupStats *stats)
+{
+    stats->memory_current = read_cgroup_value(dirfd, "memory.current");
+    stats->memory_max = read_cgroup_value(dirfd, "memory.max");
+    stats->cpu_usage_usec = -1;
+
+    char buffer[CGROUP_BUFFER_SIZE];
+    if (read_file_at(dirfd, "cpu.stat", buffer, sizeof(buffer)) > 0) {
+        char *usage = strstr(buffer, "usage_usec ");
+        if (usage) {
+            stats->cpu_usage_usec = strtoll(usage + strlen("usage_usec "), NULL, 10);
+        }
+    }
+
+    return stats->memory_current < 0 && stats->cpu_usage_usec < 0 ? -1 : 0;
+}
+
+// Function to make room for one more cgroup in a list
+static CgroupStats *grow_list (CgroupList *list)
+{
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        CgroupStats *items = realloc(list->items, capacity * sizeof(CgroupStats));
+        if (items == NULL) {
+            perror("realloc");
+            return NULL;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    return &list->items[list->count];
+}
+
+// Function to read a cgroup and add it to a list
+static void add_cgroup (CgroupList *list, int dirfd, const char *path)
+{
+    CgroupStats *stats = grow_list(list);
+    if (stats == NULL) {
+        return;
+    }
+
+    stats->path = strdup(path);
+    if (stats->path == NULL) {
+        perror("strdup");
+        return;
+    }
+    read_cgroup_stats(dirfd, stats);
+    list->count++;
+}
+
+// Function to queue a subtree path for the walker threads
+static void queue_subtree (SubtreeQueue *queue, const char *path)
+{
+    if (queue->count == queue->capacity) {
+        size_t capacity = queue->capacity ? queue->capacity * 2 : 64;
+        char **paths = realloc(queue->paths, capacity * sizeof(char *));
+        if (paths == NULL) {
+            perror("realloc");
+            return;
+        }
+        queue->paths = paths;
+        queue->capacity = capacity;
+    }
+
+    queue->paths[queue->count] = strdup(path);
+    if (queue->paths[queue->count]) {
+        queue->count++;
+    }
+}
+
+// Function to walk a cgroup and its children. Below max_depth every cgroup is
+// recorded; at max_depth the cgroup is queued for a walker thread instead.
+static void walk_cgroup (int dirfd, const char *path, int depth, int max_depth, CgroupList *list, SubtreeQueue *queue)
+{
+    if (depth == max_depth) {
+        queue_subtree(queue, path);
+        close(dirfd);
+        return;
+    }
+
+    add_cgroup(list, dirfd, path);
+
+    DIR *dir = fdopendir(dirfd);
+    if (dir == NULL) {
+        close(dirfd);
+        return;
+    }
+
+    struct dirent *entry;
+    char child_path[PATH_MAX];
+    while ((entry = readdir(dir)) != NULL) {
+        // Child cgroups are the only directories in a cgroup
+        if (entry->d_type != DT_DIR || entry->d_name[0] == '.') {
+            continue;
+        }
+
+        // Open children relative to the parent so no full path is resolved
+        int child_fd = openat(dirfd, entry->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (child_fd == -1) {
+            continue;
+        }
+        snprintf(child_path, sizeof(child_path), "%s/%s", strcmp(path, "/") == 0 ? "" : path, entry->d_name);
+        walk_cgroup(child_fd, child_path, depth + 1, max_depth, list, queue);
+    }
+
+    closedir(dir);
+}
+
+// Worker thread that walks queued subtrees until none are left
+static void *walk_worker (void *data)
+{
+    Walker *walker = data;
+    SubtreeQueue *queue = walker->queue;
+
+    size_t task;
+    while ((task = atomic_fetch_add(&queue->next, 1)) < queue->count) {
+        const char *path = queue->paths[task];
+
+        // Paths are absolute within the hierarchy, open them relative to the root
+        int dirfd = openat(queue->root_fd, path + 1, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirfd != -1) {
+            walk_cgroup(dirfd, path, 0, -1, &walker->results, queue);
+        }
+    }
+    return NULL;
+}
+
+// Function to walk the whole cgroup hierarchy, splitting subtrees across threads
+CgroupStats *walk_cgroups (const char *root, size_t *cgroup_count)
+{
+    *cgroup_count = 0;
+    int root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd == -1) {
+        fprintf(stderr, "Error opening cgroup root: %s\n", root);
+        return NULL;
+    }
+
+    // Record the top two levels here and queue everything below as subtrees,
+    // since slices such as system.slice hold most cgroups
+    CgroupList list = {0};
+    SubtreeQueue queue = {0};
+    queue.root_fd = root_fd;
+    int walk_fd = dup(root_fd);
+    if (walk_fd != -1) {
+        walk_cgroup(walk_fd, "/", 0, 2, &list, &queue);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t thread_count = cpus > 0 ? (size_t)cpus : 1;
+    if (thread_count > CGROUP_MAX_THREADS) {
+        thread_count = CGROUP_MAX_THREADS;
+    }
+    if (thread_count > queue.count) {
+        thread_count = queue.count;
+    }
+
+    // Hand the subtrees to worker threads, this thread being one of them
+    pthread_t threads[CGROUP_MAX_THREADS];
+    Walker walkers[CGROUP_MAX_THREADS];
+    size_t started = 0;
+    for (size_t t = 0; t + 1 < thread_count; t++) {
+        walkers[t].queue = &queue;
+        memset(&walkers[t].results, 0, sizeof(CgroupList));
+        if (pthread_create(&threads[t], NULL, walk_worker, &walkers[t]) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    // Walk subtrees on this thread as well
+    Walker self = {&queue, {0}};
+    walk_worker(&self);
+
+    // Merge the per-thread results
+    for (size_t t = 0; t <= started; t++) {
+        CgroupList *results = t < started ? &walkers[t].results : &self.results;
+        if (t < started) {
+            pthread_join(threads[t], NULL);
+        }
+        for (size_t i = 0; i < results->count; i++) {
+            CgroupStats *stats = grow_list(&list);
+            if (stats == NULL) {
+                free(results->items[i].path);
+                continue;
+            }
+            *stats = results->items[i];
+            list.count++;
+        }
+        free(results->items);
+    }
+
+    for (size_t i = 0; i < queue.count; i++) {
+        free(queue.paths[i]);
+    }
+    free(queue.paths);
+    close(root_fd);
+
+    *cgroup_count = list.count;
+    return list.items;
+}
+
+// Function to free a list of walked cgroups
+void free_cgroups (CgroupStats *cgroups, size_t cgroup_count)
+{
+    for (size_t i = 0; i < cgroup_count; i++) {
+        free(cgroups[i].path);
+    }
+    free(cgroups);
+}
@@ -1,130 +1,336 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <libgen.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include "config.h"
+#include "io.h"
 
-#define CONFIG_BUFFER_SIZE 64
-#define TEMP_PATH_LENGTH 256
+#define CONFIG_BUFFER_SIZE 256
+#define TEMP_PATH_LENGTH (PATH_MAX + 8)
 #define CONFIG_COMMENT_SEQ "//"
-#define DEFAULT_BASE_COLOR "255,255,255"
-#define DEFAULT_ACCENT_COLOR "20,200,255"
+#define CONFIG_DIR_NAME "sysgrab"
+#define MAX_RESOURCE_SIZE (1024 * 1024)
+
+// Function to get the path of a resource in the user config directory,
+// $XDG_CONFIG_HOME/sysgrab or ~/.config/sysgrab
+int get_user_resource_path (const char *name, char *path, size_t size)
+{
+    const char *config_home = getenv("XDG_CONFIG_HOME");
+    const char *home = getenv("HOME");
+    int len;
+
+    if (config_home && config_home[0] == '/') {
+        len = snprintf(path, size, "%s/%s/%s", config_home, CONFIG_DIR_NAME, name);
+    } else if (home && home[0] != '\0') {
+        len = snprintf(path, size, "%s/.config/%s/%s", home, CONFIG_DIR_NAME, name);
+    } else {
+        return -1;
+    }
+
+    return (len < 0 || (size_t)len >= size) ? -1 : 0;
+}
+
+// Function to get the path of a file in the user cache directory,
+// $XDG_CACHE_HOME/sysgrab or ~/.cache/sysgrab
+int get_user_cache_path (const char *name, char *path, size_t size)
+{
+    const char *cache_home = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    int len;
+
+    if (cache_home && cache_home[0] == '/') {
+        len = snprintf(path, size, "%s/%s/%s", cache_home, CONFIG_DIR_NAME, name);
+    } else if (home && home[0] != '\0') {
+        len = snprintf(path, size, "%s/.cache/%s/%s", home, CONFIG_DIR_NAME, name);
+    } else {
+        return -1;
+    }
 
-// Function to generate config file with defaults
-void generate_config_file (char *config_path)
+    return (len < 0 || (size_t)len >= size) ? -1 : 0;
+}
+
+// Function to get the path of a resource next to the executable, as shipped in release archives
+static int get_executable_resource_path (const char *name, char *path, size_t size)
+{
+    char exe_path[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+    count_syscalls(1);
+    if (len == -1) {
+        return -1;
+    }
+    exe_path[len] = '\0';
+
+    len = snprintf(path, size, "%s/%s", dirname(exe_path), name);
+    return (len < 0 || (size_t)len >= size) ? -1 : 0;
+}
+
+// Function to read a whole file with one open, one stat and one read
+static char *read_whole_file (const char *file_path)
 {
-    // Check if file exists
-    FILE *cp = fopen(config_path, "r");
-    if (cp == NULL) {
-        FILE *file = fopen(config_path, "w");
-        if (file) {
-            // Write default strings to the new file
-            fprintf(file, "base_color=%s\n", DEFAULT_BASE_COLOR);
-            fprintf(file, "accent_color=%s\n", DEFAULT_ACCENT_COLOR);
-            fclose(file);
+    int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    count_syscalls(1);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    struct stat st;
+    char *contents = NULL;
+    count_syscalls(1);
+    if (fstat(fd, &st) == 0 && st.st_size <= MAX_RESOURCE_SIZE) {
+        contents = malloc(st.st_size + 1);
+        if (contents) {
+            ssize_t len = read(fd, contents, st.st_size);
+            count_syscalls(1);
+            if (len < 0) {
+                free(contents);
+                contents = NULL;
+            } else {
+                contents[len] = '\0';
+            }
         } else {
-            perror("Failed to generate config file");
-            return;
+            perror("malloc");
         }
-    } else {
-        fclose(cp);
     }
+
+    close(fd);
+    count_syscalls(1);
+    return contents;
+}
+
+// Function to load a resource from the user config directory or next to the
+// executable. Returns NULL if neither exists, so the built-in default is used.
+char *load_resource (const char *name, char *path, size_t path_size)
+{
+    char *contents;
+
+    if (get_user_resource_path(name, path, path_size) == 0 && (contents = read_whole_file(path)) != NULL) {
+        return contents;
+    }
+    if (get_executable_resource_path(name, path, path_size) == 0 && (contents = read_whole_file(path)) != NULL) {
+        return contents;
+    }
+
+    path[0] = '\0';
+    return NULL;
+}
+
+// Function to load a file from the user cache directory, NULL if there is none
+char *load_cache (const char *name)
+{
+    char path[PATH_MAX];
+    if (get_user_cache_path(name, path, sizeof(path)) != 0) {
+        return NULL;
+    }
+    return read_whole_file(path);
+}
+
+// Function to create the parent directories of a user config or cache file if missing
+static int make_user_config_dir (const char *path)
+{
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", path);
+
+    // Create every missing component after the first one
+    for (char *slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Error creating directory: %s\n", dir);
+            return -1;
+        }
+        *slash = '/';
+    }
+    return 0;
+}
+
+// Function to atomically replace a file with new contents through a temporary file
+static int replace_file (const char *file_path, const void *contents, size_t size)
+{
+    // The temp file gets a unique name next to the target, so concurrent runs
+    // saving the same cache never write into each other's file
+    char temp_path[TEMP_PATH_LENGTH];
+    snprintf(temp_path, sizeof(temp_path), "%s_XXXXXX", file_path);
+
+    int fd = mkstemp(temp_path);
+    if (fd == -1) {
+        fprintf(stderr, "Error creating temp file: %s\n", temp_path);
+        return -1;
+    }
+    const char *data = contents;
+    size_t written = 0;
+    while (written < size) {
+        ssize_t result = write(fd, data + written, size - written);
+        if (result <= 0) {
+            break;
+        }
+        written += (size_t) result;
+    }
+    int status = (written == size && fchmod(fd, 0644) == 0) ? 0 : -1;
+    if (close(fd) != 0 || status != 0) {
+        perror("Error writing temp file");
+        remove(temp_path);
+        return -1;
+    }
+
+    // Rename the new file to the original name
+    if (rename(temp_path, file_path) != 0) {
+        perror("Error renaming temp file to original file");
+        remove(temp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to replace a file in the user cache directory with binary data
+int save_cache_data (const char *name, const void *data, size_t size)
+{
+    char path[PATH_MAX];
+    if (get_user_cache_path(name, path, sizeof(path)) != 0 || make_user_config_dir(path) != 0) {
+        return -1;
+    }
+    return replace_file(path, data, size);
+}
+
+// Function to replace a file in the user cache directory
+int save_cache (const char *name, const char *contents)
+{
+    return save_cache_data(name, contents, strlen(contents));
+}
+
+// Function to write a resource with its default contents to the user config
+// directory, leaving an existing file untouched
+int write_resource (const char *name, const char *contents, char *path, size_t path_size)
+{
+    if (get_user_resource_path(name, path, path_size) != 0) {
+        fprintf(stderr, "Cannot find a config directory, set XDG_CONFIG_HOME or HOME\n");
+        return -1;
+    }
+    if (make_user_config_dir(path) != 0) {
+        return -1;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        if (errno == EEXIST) {
+            return 0;
+        }
+        fprintf(stderr, "Error creating file: %s\n", path);
+        return -1;
+    }
+
+    size_t len = strlen(contents);
+    ssize_t written = write(fd, contents, len);
+    close(fd);
+    if (written != (ssize_t)len) {
+        fprintf(stderr, "Error writing file: %s\n", path);
+        return -1;
+    }
+    return 0;
 }
 
 // Function to validate the format of r,g,b values
 bool validate_rgb_value(const char *value) {
     int r, g, b;
     char temp;
-    
+
     // Check if the value is in the format r,g,b and each component is within the 0-255 range
     if (sscanf(value, "%d,%d,%d%c", &r, &g, &b, &temp) != 3) {
         return false;
     }
-    
+
     // Check if numbers are between 0 and 255
     if (r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255) {
         return false;
     }
-    
+
     return true;
 }
 
-// Function to edit the config.txt file
-void edit_config (char *setting, char *value, char *config_path)
+// Function to set a config value and save the result. Edits the file the config
+// was loaded from, or creates one in the user config directory when the built-in
+// defaults were in use. Returns the new contents, or NULL if nothing changed.
+char *edit_config (const char *setting, const char *value, const char *contents, char *config_path, size_t path_size)
 {
     // Input validation for RGB value
     if (!validate_rgb_value(value)) {
         fprintf(stderr, "Invalid value: %s. Expected format: r,g,b with each component between 0 and 255.\n", value);
-        return;
-    }
-
-    // Open file to read and write
-    FILE *fp = fopen(config_path, "r+");
-    if (fp == NULL) {
-        fprintf(stderr, "Error opening file: %s\n", config_path);
-        return;
+        return NULL;
     }
 
-    // Generate a temporary file path
-    char temp_path[TEMP_PATH_LENGTH];
-    snprintf(temp_path, sizeof(temp_path), "%s_temp", config_path);
-
-    // Create a new file
-    FILE *temp_fp = fopen(temp_path, "w");
-    if (temp_fp == NULL) {
-        fprintf(stderr, "Error creating temp file: %s\n", temp_path);
-        fclose(fp);
-        return;
+    // Room for the old contents plus one new line
+    size_t setting_len = strlen(setting);
+    size_t size = strlen(contents) + setting_len + strlen(value) + 3;
+    char *new_contents = malloc(size);
+    if (new_contents == NULL) {
+        perror("malloc");
+        return NULL;
     }
 
-    // Read the old config file and add to the new file with updated values
-    char line[CONFIG_BUFFER_SIZE];
+    // Copy the old config, replacing the line of the setting we want to edit
+    size_t len = 0;
     int found = 0;
-    while (fgets(line, sizeof(line), fp)) {
-        // Check if the line starts with the setting we want to edit
-        if (strncmp(line, setting, strlen(setting)) == 0 && line[strlen(setting)] == '=') {
-            fprintf(temp_fp, "%s=%s\n", setting, value);
+    const char *line = contents;
+    while (*line) {
+        const char *next = strchr(line, '\n');
+        size_t line_len = next ? (size_t)(next - line) + 1 : strlen(line);
+
+        if (strncmp(line, setting, setting_len) == 0 && line[setting_len] == '=') {
+            // Drop any duplicate lines of the same setting
+            if (!found) {
+                len += snprintf(new_contents + len, size - len, "%s=%s\n", setting, value);
+            }
             found = 1;
         } else {
-            fputs(line, temp_fp);
+            memcpy(new_contents + len, line, line_len);
+            len += line_len;
+            if (!next) {
+                new_contents[len++] = '\n';
+            }
         }
+        line += line_len;
     }
+    new_contents[len] = '\0';
 
-    // If setting not found in the old file, append it at the end of the new file
+    // If setting not found in the old config, append it at the end
     if (!found) {
-        fprintf(temp_fp, "%s=%s\n", setting, value);
+        snprintf(new_contents + len, size - len, "%s=%s\n", setting, value);
     }
 
-    fclose(fp);
-    fclose(temp_fp);
-
-    // Remove the original file
-    if (remove(config_path) != 0) {
-        perror("Error deleting original file");
-        remove(temp_path);
-        return;
+    // Save to the user config directory if the built-in defaults were loaded
+    if (config_path[0] == '\0') {
+        if (get_user_resource_path(CONFIG_FILE_NAME, config_path, path_size) != 0 || make_user_config_dir(config_path) != 0) {
+            fprintf(stderr, "Cannot find a config directory, set XDG_CONFIG_HOME or HOME\n");
+            config_path[0] = '\0';
+            free(new_contents);
+            return NULL;
+        }
     }
 
-    // Rename the new file to the original name
-    if (rename(temp_path, config_path) != 0) {
-        perror("Error renaming temp file to original file");
-        remove(temp_path);
+    if (replace_file(config_path, new_contents, strlen(new_contents)) != 0) {
+        free(new_contents);
+        return NULL;
     }
+    return new_contents;
 }
 
-// Function to get config key-value pairs from config file
-Config *get_config (size_t *config_count, char *config_path)
+// Function to get config key-value pairs from config contents
+Config *get_config (size_t *config_count, const char *contents)
 {
-    // Read the config file
-    FILE *config_fp = fopen(config_path, "r");
-    if (config_fp == NULL) {
-        fprintf(stderr, "Error opening file: %s\n", config_path);
-        return NULL;
-    }
-
     Config *config = NULL;
     char buffer[CONFIG_BUFFER_SIZE];
     size_t count = 0;
 
-    while (fgets(buffer, CONFIG_BUFFER_SIZE, config_fp)) {
-        // Remove newline
-        buffer[strcspn(buffer, "\n")] = 0; 
+    const char *line = contents;
+    while (line && *line) {
+        // Copy one line, truncated to the buffer size
+        const char *next = strchr(line, '\n');
+        size_t line_len = next ? (size_t)(next - line) : strlen(line);
+        size_t copy_len = line_len < CONFIG_BUFFER_SIZE - 1 ? line_len : CONFIG_BUFFER_SIZE - 1;
+        memcpy(buffer, line, copy_len);
+        buffer[copy_len] = '\0';
+        line = next ? next + 1 : NULL;
 
         // Ignore comment lines
         if (strncmp(buffer, CONFIG_COMMENT_SEQ, 2) == 0) {
@@ -140,8 +346,7 @@ Config *get_config (size_t *config_count, char *config_path)
             Config *new_config = realloc(config, (count + 1) * sizeof(Config));
             if (new_config == NULL) {
                 perror("realloc");
-                free(config);
-                fclose(config_fp);
+                free_config(config, count);
                 return NULL;
             }
             config = new_config;
@@ -152,8 +357,7 @@ Config *get_config (size_t *config_count, char *config_path)
 
             if (config[count].name == NULL || config[count].value == NULL) {
                 perror("strdup");
-                free(config);
-                fclose(config_fp);
+                free_config(config, count + 1);
                 return NULL;
             }
 
@@ -161,11 +365,9 @@ Config *get_config (size_t *config_count, char *config_path)
         }
     }
 
-    fclose(config_fp);
-
     // Set the config count variable
     *config_count = count;
-    
+
     return config;
 }
 
@@ -177,7 +379,7 @@ void free_config(Config *config, size_t config_count)
         free(config[i].name);
         free(config[i].value);
     }
-    
+
     // Free the pointer to the config array
     free(config);
-}
\ No newline at end of file
+}
@@ -1,15 +1,28 @@
 #include <pwd.h>
-#include <math.h>
 #include <errno.h>
 #include <limits.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <sys/utsname.h>
 
 #include "data.h"
+#include "cgroup.h"
+#include "topology.h"
+#include "sensors.h"
+#include "shell.h"
+#include "pci.h"
 
 #define DATA_BUFFER_SIZE 128
+#define COMMAND_BUFFER_SIZE 8192
+#define PASSWD_BUFFER_SIZE 1024
+#define PREFETCH_PATHS 3
 
-// Function to remove prefixes, suffixes, and whitespace from a string
-char *clean_string (char *string, const char *prefix, const char *suffix)
+// Pressure stall files and their short names, in PressureResource order
+static const char *PRESSURE_PATHS[PRESSURE_COUNT] = {"/proc/pressure/cpu", "/proc/pressure/memory", "/proc/pressure/io"};
+static const char *PRESSURE_NAMES[PRESSURE_COUNT] = {"cpu", "mem", "io"};
+
+// Function to remove prefixes, suffixes, and whitespace from a string in place
+static char *clean_string (char *string, const char *prefix, const char *suffix)
 {
     char *start = string;
     char *end;
@@ -24,363 +37,529 @@ char *clean_string (char *string, const char *prefix, const char *suffix)
         start++;
     }
 
-    // Find the new end after trimming leading whitespace
-    end = start + strlen(start);
-
     // Remove the suffix if it exists
     if (suffix && (end = strstr(start, suffix)) != NULL) {
         *end = '\0';
     }
 
-    // After potentially trimming the suffix, set the `end` pointer again to the last character of the meaningful content.
-    end = start + strlen(start) - 1;
-
     // Trim trailing whitespace
-    while (end > start && isspace((unsigned char)*end)) {
-        *end = '\0';
+    end = start + strlen(start);
+    while (end > start && isspace((unsigned char)end[-1])) {
         end--;
     }
+    *end = '\0';
 
-    // Allocate a new string with the cleaned content
-    char *cleaned_string = malloc(strlen(start) + 1);
-    if (cleaned_string == NULL) {
-        perror("malloc");
-        return NULL;
+    // Move the cleaned content to the start of the string
+    memmove(string, start, end - start + 1);
+    return string;
+}
+
+// Function to copy the cleaned line holding a look up value, or the first line,
+// from a buffer. Returns the length of the result, or -1 if there is no such line.
+static int get_from_buffer (const char *contents, const char *look_up, const char *prefix, const char *suffix, char *result, size_t size)
+{
+    const char *line = contents;
+    while (line && *line) {
+        const char *next = strchr(line, '\n');
+        size_t line_len = next ? (size_t)(next - line) + 1 : strlen(line);
+
+        // Use the line holding the look up value if provided, otherwise the first line
+        if (look_up == NULL || strncmp(line, look_up, strlen(look_up)) == 0) {
+            // Truncate like a fixed size line read would
+            if (line_len > size - 1) {
+                line_len = size - 1;
+            }
+            memcpy(result, line, line_len);
+            result[line_len] = '\0';
+
+            return (int)strlen(clean_string(result, prefix, suffix));
+        }
+
+        line = next ? next + 1 : NULL;
     }
 
-    strcpy(cleaned_string, start);
-    return cleaned_string;
+    return -1;
 }
 
-// Function to extract a double value from a string
-double extract_double (const char *string)
+// Function to read a file, using the prefetched contents if it was part of the batch.
+// The prefetch can be NULL to always read from disk.
+static ssize_t read_source (const Prefetch *prefetch, const char *file_path, char *buffer, size_t size)
 {
-    // Extract the first double from the input string
-    char *endptr;
-    double value = strtod(string, &endptr);
-
-    // If no valid conversion could be performed
-    if (string == endptr) {
-        perror("No valid double found in the string.\n");
-        return NAN;
+    for (size_t i = 0; prefetch && i < prefetch->count; i++) {
+        const FileRead *read = &prefetch->reads[i];
+        if (strcmp(read->path, file_path) == 0) {
+            if (read->len < 0) {
+                return -1;
+            }
+            size_t len = (size_t)read->len < size - 1 ? (size_t)read->len : size - 1;
+            memcpy(buffer, read->buffer, len);
+            buffer[len] = '\0';
+            return (ssize_t)len;
+        }
     }
 
-    return value;
+    return read_file_buffer(file_path, buffer, size);
 }
 
-// Function to convert a double to a string
-char *double_to_string(const double value, const char *conv_spec)
+// Function to copy a cleaned line from a file
+static int get_from_file (const Prefetch *prefetch, const char *file_path, const char *look_up, const char *prefix, const char *suffix, char *result, size_t size)
 {
-    // Determine the required buffer size using the custom conversion specifier
-    char format[32];
-    snprintf(format, sizeof(format), "%%%s", conv_spec);
-
-    // Determine string length of the double
-    int size = snprintf(NULL, 0, format, value);
-    if (size < 0) {
-        perror("snprintf");
-        return NULL;
+    // Read file
+    char buffer[PROC_BUFFER_SIZE];
+    if (read_source(prefetch, file_path, buffer, sizeof(buffer)) < 0) {
+        return -1;
     }
 
-    // Allocate the exact buffer size required
-    char *string = malloc(size + 1);  // +1 for the null terminator
-    if (string == NULL) {
-        perror("malloc");
-        return NULL;
+    return get_from_buffer(buffer, look_up, prefix, suffix, result, size);
+}
+
+// Function to read the whole output of a command
+static ssize_t read_command (const char *command, char *buffer, size_t size)
+{
+    FILE *fp = popen(command, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Error with command: %s\n", command);
+        return -1;
     }
 
-    // Convert the result back to a string using the custom conversion specifier
-    snprintf(string, size + 1, format, value);
-    return string;
+    size_t len = fread(buffer, 1, size - 1, fp);
+    buffer[len] = '\0';
+    pclose(fp);
+    return (ssize_t)len;
 }
 
-// Function to extract an integer value from a string
-int extract_int(const char *string)
+// Function to read the files behind the given datapoints in a single batch into a
+// caller-owned prefetch. Returns the backend that did the reads, which is IO_SYNC
+// after io_uring fell back.
+IoBackend prefetch_info (Prefetch *prefetch, IoBackend backend, const DataPoint *dps, size_t count)
 {
-    // Extract the first integer from the input string
-    char *endptr;
+    clear_prefetch(prefetch);
 
-    // Reset errno before calling strtol
-    errno = 0;  
-    long value = strtol(string, &endptr, 10);
+    for (size_t i = 0; i < count; i++) {
+        const char *paths[PREFETCH_PATHS] = {NULL, NULL, NULL};
+        switch (dps[i]) {
+            case OS:
+                paths[0] = "/etc/os-release";
+                break;
+            case COMPUTER:
+                paths[0] = "/sys/devices/virtual/dmi/id/product_name";
+                paths[1] = "/sys/devices/virtual/dmi/id/product_version";
+                break;
+            case UPTIME:
+                paths[0] = "/proc/uptime";
+                break;
+            case MEMORY:
+                paths[0] = "/proc/meminfo";
+                break;
+            case LOAD:
+                paths[0] = "/proc/loadavg";
+                break;
+            case PRESSURE:
+                for (int p = 0; p < PRESSURE_COUNT; p++) {
+                    paths[p] = PRESSURE_PATHS[p];
+                }
+                break;
+            default:
+                break;
+        }
 
-    // If no valid conversion could be performed
-    if (string == endptr) {
-        perror("No valid integer found in the string.");
-        return INT_MIN;
+        for (int p = 0; p < PREFETCH_PATHS && paths[p] && prefetch->count < PREFETCH_MAX; p++) {
+            FileRead *read = &prefetch->reads[prefetch->count];
+            read->path = paths[p];
+            read->buffer = prefetch->buffers[prefetch->count];
+            read->size = PROC_BUFFER_SIZE;
+            read->len = -1;
+            prefetch->count++;
+        }
     }
 
-    // Check for overflow and underflow
-    if ((errno == ERANGE && (value == LONG_MAX || value == LONG_MIN)) || (value > INT_MAX || value < INT_MIN)) {
-        perror("Integer out of range.");
-        return INT_MIN;
-    }
+    return read_files(prefetch->reads, prefetch->count, backend);
+}
 
-    return (int)value;
+// Function to drop prefetched contents so later reads see fresh values
+void clear_prefetch (Prefetch *prefetch)
+{
+    prefetch->count = 0;
 }
 
-char *int_to_string(int value)
+// Function to parse the memory components of /proc/meminfo in one pass, sizes in kB and hugepages in pages
+int parse_meminfo (const char *contents, MemInfo *mem)
 {
-    // Determine the required buffer size
-    int size = snprintf(NULL, 0, "%d", value);
-    if (size < 0) {
-        perror("snprintf");
-        return NULL;
-    }
+    const struct {
+        const char *key;
+        long *value;
+    } fields[] = {
+        {"MemTotal:", &mem->total},
+        {"MemFree:", &mem->free},
+        {"Buffers:", &mem->buffers},
+        {"Cached:", &mem->cached},
+        {"Shmem:", &mem->shmem},
+        {"SReclaimable:", &mem->sreclaimable},
+        {"SwapTotal:", &mem->swap_total},
+        {"SwapFree:", &mem->swap_free},
+        {"HugePages_Total:", &mem->huge_total},
+        {"HugePages_Free:", &mem->huge_free},
+        {"HugePages_Rsvd:", &mem->huge_rsvd},
+        {"Hugepagesize:", &mem->huge_size}
+    };
+    const size_t field_count = sizeof(fields) / sizeof(fields[0]);
+
+    memset(mem, 0, sizeof(*mem));
+
+    // Match each line against the wanted keys and stop once all are found
+    size_t found = 0;
+    const char *line = contents;
+    while (line && *line && found < field_count) {
+        for (size_t i = 0; i < field_count; i++) {
+            size_t key_len = strlen(fields[i].key);
+            if (strncmp(line, fields[i].key, key_len) == 0) {
+                *fields[i].value = strtol(line + key_len, NULL, 10);
+                found++;
+                break;
+            }
+        }
 
-    // Allocate the exact buffer size required
-    char *string = malloc(size + 1);  // +1 for the null terminator
-    if (string == NULL) {
-        perror("malloc");
-        return NULL;
+        // Move to the start of the next line
+        line = strchr(line, '\n');
+        if (line) {
+            line++;
+        }
     }
 
-    // Convert the result back to a string
-    snprintf(string, size + 1, "%d", value);
-    return string;
+    return found > 0 ? 0 : -1;
 }
 
-// Function to get a string from a command
-char *get_from_command (const char *command, const char *look_up, const char *prefix, const char *suffix)
+// Function to parse the system uptime in seconds from /proc/uptime
+int parse_uptime (const char *contents, double *uptime)
 {
-    char buffer[DATA_BUFFER_SIZE];
-    char *result = malloc(DATA_BUFFER_SIZE);
-    
-    if (result == NULL) {
-        perror("malloc");
-        return NULL;
-    }
+    return sscanf(contents, "%lf", uptime) == 1 ? 0 : -1;
+}
 
-    // Get the output from the command
-    FILE *fp = popen(command, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "Error with command: %s\n", command);
-        free(result);
-        return NULL;
+// Function to parse the 1, 5 and 15 minute load averages from /proc/loadavg
+int parse_loadavg (const char *contents, double load[3])
+{
+    return sscanf(contents, "%lf %lf %lf", &load[0], &load[1], &load[2]) == 3 ? 0 : -1;
+}
+
+// Function to parse the "some avg10=... avg60=... avg300=... total=..." line of a pressure file
+int parse_pressure (const char *contents, Pressure *pressure)
+{
+    const struct {
+        const char *key;
+        double *value;
+    } averages[] = {
+        {"avg10=", &pressure->avg10},
+        {"avg60=", &pressure->avg60},
+        {"avg300=", &pressure->avg300}
+    };
+
+    pressure->avg10 = pressure->avg60 = pressure->avg300 = -1;
+    pressure->total = 0;
+    if (strncmp(contents, "some ", 5) != 0) {
+        return -1;
     }
 
-    // Initialize result
-    result[0] = '\0';
-
-    // Search for look up value if provided
-    if (look_up) {
-        while(fgets(buffer, sizeof(buffer), fp)) {
-            if (strncmp(buffer, look_up, strlen(look_up)) == 0) {
-                strcpy(result, buffer);
-                char *cleaned_result = clean_string(result, prefix, suffix);
-                free(result);
-                result = cleaned_result;
-                break;
-            }
-        }
-    } else {
-        // Otherwise get first line
-        if (fgets(buffer, sizeof(buffer), fp)) {
-            strcpy(result, buffer);
-            char *cleaned_result = clean_string(result, prefix, suffix);
-            free(result);
-            result = cleaned_result;
+    // The fields always come in the same order, so each search starts after the last
+    const char *cursor = contents + 5;
+    for (size_t i = 0; i < sizeof(averages) / sizeof(averages[0]); i++) {
+        const char *field = strstr(cursor, averages[i].key);
+        if (field == NULL) {
+            return -1;
         }
+        char *end;
+        *averages[i].value = strtod(field + strlen(averages[i].key), &end);
+        cursor = end;
     }
 
-    pclose(fp);
-    return result;
+    const char *total = strstr(cursor, "total=");
+    if (total) {
+        pressure->total = strtoull(total + 6, NULL, 10);
+    }
+    return 0;
 }
 
-// Function to get a string from a file
-char *get_from_file (const char *file_path, const char *look_up, const char *prefix, const char *suffix)
+// Function to read the memory components from /proc/meminfo
+int read_meminfo (const Prefetch *prefetch, MemInfo *mem)
+{
+    char buffer[PROC_BUFFER_SIZE];
+    if (read_source(prefetch, "/proc/meminfo", buffer, sizeof(buffer)) < 0) {
+        return -1;
+    }
+
+    return parse_meminfo(buffer, mem);
+}
+
+// Function to read the system uptime in seconds
+int read_uptime (const Prefetch *prefetch, double *uptime)
 {
     char buffer[DATA_BUFFER_SIZE];
-    char *result = malloc(DATA_BUFFER_SIZE);
+    if (read_source(prefetch, "/proc/uptime", buffer, sizeof(buffer)) < 0) {
+        return -1;
+    }
 
-    if (result == NULL) {
-        perror("malloc");
-        return NULL;
+    return parse_uptime(buffer, uptime);
+}
+
+// Function to read the 1, 5 and 15 minute load averages
+int read_loadavg (const Prefetch *prefetch, double load[3])
+{
+    char buffer[DATA_BUFFER_SIZE];
+    if (read_source(prefetch, "/proc/loadavg", buffer, sizeof(buffer)) < 0) {
+        return -1;
     }
 
-    // Read file
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
-        free(result);
-        return NULL;
+    return parse_loadavg(buffer, load);
+}
+
+// Function to read the pressure stall information of a resource
+int read_pressure (const Prefetch *prefetch, PressureResource resource, Pressure *pressure)
+{
+    // Only the "some" line is needed, so one small read is enough
+    char buffer[DATA_BUFFER_SIZE];
+    if (read_source(prefetch, PRESSURE_PATHS[resource], buffer, sizeof(buffer)) < 0) {
+        pressure->avg10 = pressure->avg60 = pressure->avg300 = -1;
+        return -1;
     }
 
-    // Initialize result
-    result[0] = '\0';
-
-    // Search for look up value if provided
-    if (look_up) {
-        while(fgets(buffer, sizeof(buffer), fp)) {
-            if (strncmp(buffer, look_up, strlen(look_up)) == 0) {
-                strcpy(result, buffer);
-                char *cleaned_result = clean_string(result, prefix, suffix);
-                free(result);
-                result = cleaned_result;
-                break;
-            }
+    return parse_pressure(buffer, pressure);
+}
+
+// Function to format an uptime in seconds as HH:MM:SS
+int format_uptime (double uptime, char *buffer, size_t size)
+{
+    int sec = (int)uptime;
+    int h = sec / 3600;
+    int m = (sec - (3600 * h)) / 60;
+    int s = sec - (3600 * h) - (60 * m);
+    return snprintf(buffer, size, "%d:%.2d:%.2d", h, m, s);
+}
+
+// Function to format the used and total memory in MiB
+int format_memory (const MemInfo *mem, char *buffer, size_t size)
+{
+    // Calculate current memory usage and total available memory in MiB
+    long used = mem->total + mem->shmem - mem->free - mem->buffers - mem->cached - mem->sreclaimable;
+    return snprintf(buffer, size, "%.0fMiB / %.0fMiB", used / 1024.0, mem->total / 1024.0);
+}
+
+// Function to format the 1, 5 and 15 minute load averages
+int format_load (const double load[3], char *buffer, size_t size)
+{
+    return snprintf(buffer, size, "%.2f %.2f %.2f", load[0], load[1], load[2]);
+}
+
+// Function to format the 10 second pressure averages, e.g. "cpu 3.2% mem 0.0% io 12.5%"
+int format_pressure (const Pressure pressure[PRESSURE_COUNT], char *buffer, size_t size)
+{
+    size_t len = 0;
+    buffer[0] = '\0';
+    for (int resource = 0; resource < PRESSURE_COUNT && len < size; resource++) {
+        if (pressure[resource].avg10 < 0) {
+            continue;
         }
-    } else {
-        // Otherwise get first line
-        if (fgets(buffer, sizeof(buffer), fp)) {
-            strcpy(result, buffer);
-            char *cleaned_result = clean_string(result, prefix, suffix);
-            free(result);
-            result = cleaned_result;
+        len += snprintf(buffer + len, size - len, "%s%s %.1f%%", len > 0 ? " " : "",
+                        PRESSURE_NAMES[resource], pressure[resource].avg10);
+    }
+    return (int)len;
+}
+
+// Function to format a cgroup as "path, used / max, CPU time", leaving out unavailable values
+int format_cgroup (const CgroupStats *stats, char *buffer, size_t size)
+{
+    char memory[DATA_BUFFER_SIZE] = "", cpu[DATA_BUFFER_SIZE] = "";
+    if (stats->memory_current >= 0) {
+        if (stats->memory_max >= 0) {
+            snprintf(memory, sizeof(memory), ", %lldMiB / %lldMiB", stats->memory_current >> 20, stats->memory_max >> 20);
+        } else {
+            snprintf(memory, sizeof(memory), ", %lldMiB / max", stats->memory_current >> 20);
         }
     }
-    fclose(fp);
-    return result;
+    if (stats->cpu_usage_usec >= 0) {
+        snprintf(cpu, sizeof(cpu), ", %.1fs CPU", stats->cpu_usage_usec / 1e6);
+    }
+
+    return snprintf(buffer, size, "%s%s%s", stats->path, memory, cpu);
 }
 
-// Function to return a formatted string for a system datapoint
-char *get_info (DataPoint dp)
+// Function to write the formatted string for a system datapoint into a buffer, reading
+// files from the prefetch when it holds them. Returns the length of the string, or -1
+// if the datapoint is not available.
+int format_info (const Prefetch *prefetch, DataPoint dp, char *buffer, size_t size)
 {
-    char *result = NULL;
+    int len = -1;
     switch (dp) {
         case USERNAME: {
-            struct passwd *pw = getpwuid(geteuid());
-            if (pw) {
-                result = strdup(pw->pw_name);
+            // The reentrant lookup keeps the entry in this frame instead of static storage
+            struct passwd entry, *pw = NULL;
+            char entry_buffer[PASSWD_BUFFER_SIZE];
+            if (getpwuid_r(geteuid(), &entry, entry_buffer, sizeof(entry_buffer), &pw) == 0 && pw) {
+                len = snprintf(buffer, size, "%s", pw->pw_name);
             } else {
-                perror("getpwuid");
+                perror("getpwuid_r");
             }
             break;
         }
         case HOSTNAME: {
-            char hostname[DATA_BUFFER_SIZE];
-            if (gethostname(hostname, DATA_BUFFER_SIZE) == 0) {
-                result = strdup(hostname);
+            if (gethostname(buffer, size) == 0) {
+                buffer[size - 1] = '\0';
+                len = (int)strlen(buffer);
             } else {
                 perror("gethostname");
             }
             break;
         }
         case OS: {
-            result = get_from_file("/etc/os-release", "PRETTY_NAME", "PRETTY_NAME=\"", "\"\n");
+            len = get_from_file(prefetch, "/etc/os-release", "PRETTY_NAME", "PRETTY_NAME=\"", "\"\n", buffer, size);
             break;
         }
         case COMPUTER: {
-            char *name = get_from_file("/sys/devices/virtual/dmi/id/product_name", NULL, "", "\n");
-            char *version = get_from_file("/sys/devices/virtual/dmi/id/product_version", NULL, "", "\n");
-    
-            if (name != NULL && version != NULL) {
+            char name[DATA_BUFFER_SIZE], version[DATA_BUFFER_SIZE];
+            if (get_from_file(prefetch, "/sys/devices/virtual/dmi/id/product_name", NULL, "", "\n", name, sizeof(name)) >= 0 &&
+                get_from_file(prefetch, "/sys/devices/virtual/dmi/id/product_version", NULL, "", "\n", version, sizeof(version)) >= 0) {
                 // Concatenate name and version
-                strcat(name, " ");
-                result = strcat(name, version);
-            } else {
-                result = NULL;
+                len = snprintf(buffer, size, "%s %s", name, version);
             }
             break;
         }
-        case ARCHITECTURE: {
-            result = get_from_command("uname -m", NULL, "", "\n");
-            break;
-        }
+        case ARCHITECTURE:
         case KERNEL: {
-            result = get_from_command("uname -r", NULL, "", "\n");
+            struct utsname uts;
+            if (uname(&uts) == 0) {
+                len = snprintf(buffer, size, "%s", dp == ARCHITECTURE ? uts.machine : uts.release);
+            } else {
+                perror("uname");
+            }
             break;
         }
         case SHELL: {
-            char *shell = getenv("SHELL");
-
-            // Get the token after the last /
-            char *last = strrchr(shell, '/');
-            if (last != NULL) {
-                result = last + 1;
+            // Detected from the parent process or $SHELL without running the shell
+            ShellInfo shell;
+            if (detect_shell(&shell) == 0) {
+                len = snprintf(buffer, size, shell.version[0] ? "%s %s" : "%s", shell.name, shell.version);
             }
             break;
         }
+        case TERMINAL:
+            if (detect_terminal(buffer, size) == 0) {
+                len = strlen(buffer);
+            }
+            break;
         case UPTIME: {
-            result = get_from_file("/proc/uptime", NULL, "", "\n");
-            if (result) {
-                // Convert seconds to HH:MM:SS
-                int sec = extract_int(result), h, m, s;
-                h = sec / 3600;
-                m = (sec - (3600 * h)) / 60;
-                s = sec - (3600 * h) - (60 * m);
-                free(result);
-
-                // Calculate the required buffer size
-                int buf_size = snprintf(NULL, 0, "%d:%.2d:%.2d", h, m, s) + 1;
-                result = malloc(buf_size);
-                if (result) {
-                    // Print to a formatted string
-                    snprintf(result, buf_size, "%d:%.2d:%.2d", h, m, s);
-                }
+            double uptime;
+            if (read_uptime(prefetch, &uptime) == 0) {
+                len = format_uptime(uptime, buffer, size);
             }
             break;
         }
         case CPU: {
-            char *cpu = get_from_command("lscpu", "Model name:", "Model name:", "\n");
-            char *threads = get_from_command("lscpu", "CPU(s):", "CPU(s): ", "\n");
-            char *freq = get_from_command("lscpu", "CPU max MHz", "CPU max MHz:", "\n");
-
-            int th = extract_int(threads);
-            double gh = extract_double(freq) / 1000;
-
-            if (cpu && threads && freq) {
-                char *finalcpu = malloc(strlen(cpu) + strlen(threads) + strlen(freq) + 10);
-                if (finalcpu) {
-                    // Print to a formatted string
-                    snprintf(finalcpu, strlen(cpu) + strlen(threads) + strlen(freq) + 10,
-                            "%s (%s) @ %sGHz", cpu, int_to_string(th), double_to_string(gh, ".2f"));
-                    free(cpu);
-                    free(threads);
-                    free(freq);
-                    result = finalcpu;
-                }
+            // Run lscpu once and pick every field from its output
+            char output[COMMAND_BUFFER_SIZE];
+            if (read_command("lscpu", output, sizeof(output)) <= 0) {
+                break;
+            }
+
+            char cpu[DATA_BUFFER_SIZE], threads[DATA_BUFFER_SIZE], freq[DATA_BUFFER_SIZE];
+            if (get_from_buffer(output, "Model name:", "Model name:", "\n", cpu, sizeof(cpu)) < 0 ||
+                get_from_buffer(output, "CPU(s):", "CPU(s):", "\n", threads, sizeof(threads)) < 0) {
+                break;
             }
-            break;
-        }
-        case MEMORY: {
-            int to = 0, sh = 0, fr = 0, bu = 0, ca = 0, sr = 0;
 
-            char *total_mem = get_from_file("/proc/meminfo", "MemTotal", "MemTotal:", " kB\n");
-            if (total_mem) {
-                to = extract_int(total_mem);
-                free(total_mem);
+            // Virtual machines often do not report a maximum frequency
+            if (get_from_buffer(output, "CPU max MHz", "CPU max MHz:", "\n", freq, sizeof(freq)) >= 0) {
+                len = snprintf(buffer, size, "%s (%d) @ %.2fGHz", cpu, atoi(threads), strtod(freq, NULL) / 1000);
+            } else {
+                len = snprintf(buffer, size, "%s (%d)", cpu, atoi(threads));
             }
-            char *sh_mem = get_from_file("/proc/meminfo", "Shmem:", "Shmem:", " kB\n");
-            if (sh_mem) {
-                sh = extract_int(sh_mem);
-                free(sh_mem);
+            break;
+        }
+        case TOPOLOGY: {
+            Topology topology;
+            if (read_topology(&topology) == 0) {
+                len = format_topology(&topology, buffer, size);
             }
-            char *free_mem = get_from_file("/proc/meminfo", "MemFree", "MemFree:", " kB\n");
-            if (free_mem) {
-                fr = extract_int(free_mem);
-                free(free_mem);
+            break;
+        }
+        case MEMORY: {
+            MemInfo mem;
+            if (read_meminfo(prefetch, &mem) == 0) {
+                len = format_memory(&mem, buffer, size);
             }
-            char *buffer_mem = get_from_file("/proc/meminfo", "Buffers", "Buffers:", " kB\n");
-            if (buffer_mem) {
-                bu = extract_int(buffer_mem);
-                free(buffer_mem);
+            break;
+        }
+        case LOAD: {
+            double load[3];
+            if (read_loadavg(prefetch, load) == 0) {
+                len = format_load(load, buffer, size);
             }
-            char *sr_mem = get_from_file("/proc/meminfo", "SReclaimable", "SReclaimable:", " kB\n");
-            if (sr_mem) {
-                sr = extract_int(sr_mem);
-                free(sr_mem);
+            break;
+        }
+        case PRESSURE: {
+            Pressure pressure[PRESSURE_COUNT];
+            for (int resource = 0; resource < PRESSURE_COUNT; resource++) {
+                read_pressure(prefetch, resource, &pressure[resource]);
             }
-            char *cached_mem = get_from_file("/proc/meminfo", "Cached", "Cached:", " kB\n");
-            if (cached_mem) {
-                ca = extract_int(cached_mem);
-                free(cached_mem);
+            len = format_pressure(pressure, buffer, size);
+            break;
+        }
+        case CGROUP: {
+            char root[DATA_BUFFER_SIZE], path[PATH_MAX], dir_path[PATH_MAX + DATA_BUFFER_SIZE];
+            if (find_cgroup_root(root, sizeof(root)) != 0 || get_own_cgroup(path, sizeof(path)) != 0) {
+                break;
             }
 
-            // Calculate current memory usage and total available memory in MiB
-            char *num = double_to_string((to + sh - fr - bu - ca - sr) / 1024.0, ".0f");
-            char *denom = double_to_string(to / 1024.0, ".0f");
+            snprintf(dir_path, sizeof(dir_path), "%s%s", root, path);
+            int dirfd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dirfd == -1) {
+                break;
+            }
+            CgroupStats stats;
+            read_cgroup_stats(dirfd, &stats);
+            close(dirfd);
 
-            if (num && denom) {
-                result = malloc(strlen(num) + strlen(denom) + 20);
-                if (result) {
-                    // Print to a formatted string
-                    snprintf(result, strlen(num) + strlen(denom) + 20, "%sMiB / %sMiB", num, denom);
-                }
-                free(num);
-                free(denom);
+            stats.path = path;
+            len = format_cgroup(&stats, buffer, size);
+            break;
+        }
+        case SENSORS: {
+            SensorReading readings[MAX_SENSORS];
+            int count = read_sensors(readings, MAX_SENSORS);
+            if (count > 0) {
+                len = format_sensors(readings, count, buffer, size);
+            }
+            break;
+        }
+        case DEVICES: {
+            // Names come from pci.ids when it is installed, hex IDs otherwise
+            PciDevice devices[MAX_PCI_DEVICES];
+            size_t count = list_pci_devices(devices, MAX_PCI_DEVICES);
+            if (count > 0) {
+                PciIds *ids = open_pci_ids();
+                len = format_pci_devices(devices, count, ids, buffer, size);
+                close_pci_ids(ids);
             }
             break;
         }
+        default:
+            break;
+    }
+
+    if (len <= 0) {
+        return -1;
+    }
+    return (size_t)len < size ? len : (int)size - 1;
+}
+
+// Function to return a formatted string for a system datapoint, which the caller frees
+char *get_info (const Prefetch *prefetch, DataPoint dp)
+{
+    char buffer[INFO_BUFFER_SIZE];
+    if (format_info(prefetch, dp, buffer, sizeof(buffer)) < 0) {
+        return NULL;
+    }
+
+    char *result = strdup(buffer);
+    if (result == NULL) {
+        perror("strdup");
     }
     return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,259 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "heatmap.h"
+#include "topology.h"
+#include "io.h"
+
+#define HEATMAP_PATH_SIZE 128
+#define HEATMAP_FREQ_BUFFER_SIZE 32
+#define HEATMAP_STAT_LINE_SIZE 160
+#define HEATMAP_ROW_CELLS 32
+#define HEATMAP_CELL_SIZE 48
+#define HEATMAP_CELL "▀"
+
+// Colors the utilization and frequency scales run between
+static const Color IDLE_COLOR = {40, 160, 60};
+static const Color BUSY_COLOR = {230, 50, 40};
+static const Color NO_DATA_COLOR = {70, 70, 70};
+
+// Function to open a per-CPU sysfs file relative to the cpu directory
+static int open_cpu_file (int dirfd, int cpu, const char *name)
+{
+    char path[HEATMAP_PATH_SIZE];
+    snprintf(path, sizeof(path), "cpu%d/cpufreq/%s", cpu, name);
+    count_syscalls(1);
+    return openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+}
+
+// Function to reread an open sysfs number file from the start
+static long pread_number (int fd)
+{
+    char buffer[HEATMAP_FREQ_BUFFER_SIZE];
+    if (fd == -1) {
+        return -1;
+    }
+
+    // sysfs regenerates an attribute on every read from offset zero
+    ssize_t len = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    count_syscalls(1);
+    if (len <= 0) {
+        return -1;
+    }
+    buffer[len] = '\0';
+    return strtol(buffer, NULL, 10);
+}
+
+// Function to open the frequency files of every online CPU and /proc/stat once
+Heatmap *open_heatmap (void)
+{
+    char buffer[HEATMAP_PATH_SIZE];
+    CpuSet online;
+    if (read_file_buffer("/sys/devices/system/cpu/online", buffer, sizeof(buffer)) <= 0 || parse_cpulist(buffer, &online) != 0) {
+        fprintf(stderr, "Error reading online CPUs\n");
+        return NULL;
+    }
+
+    Heatmap *heatmap = calloc(1, sizeof(Heatmap));
+    if (heatmap == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+
+    int count = cpuset_count(&online);
+    heatmap->cpu_count = count;
+    heatmap->cpus = calloc(count, sizeof(int));
+    heatmap->freq_fds = calloc(count, sizeof(int));
+    heatmap->max_freq = calloc(count, sizeof(long));
+    heatmap->cur_freq = calloc(count, sizeof(long));
+    heatmap->prev_busy = calloc(count, sizeof(unsigned long long));
+    heatmap->prev_total = calloc(count, sizeof(unsigned long long));
+    heatmap->util = calloc(count, sizeof(double));
+    for (int i = 0; heatmap->freq_fds && i < count; i++) {
+        heatmap->freq_fds[i] = -1;
+    }
+
+    // Every cpu line of /proc/stat fits in a fixed line size
+    heatmap->stat_size = (size_t)(count + 1) * HEATMAP_STAT_LINE_SIZE + 4096;
+    heatmap->stat_buffer = malloc(heatmap->stat_size);
+    heatmap->stat_fd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    count_syscalls(1);
+
+    int index = 0;
+    for (int cpu = cpuset_next(&online, 0); cpu >= 0; cpu = cpuset_next(&online, cpu + 1)) {
+        heatmap->max_cpu = cpu;
+    }
+    heatmap->slot_of_cpu = malloc((heatmap->max_cpu + 1) * sizeof(int));
+
+    if (heatmap->cpus == NULL || heatmap->freq_fds == NULL || heatmap->max_freq == NULL ||
+        heatmap->cur_freq == NULL || heatmap->prev_busy == NULL || heatmap->prev_total == NULL ||
+        heatmap->util == NULL || heatmap->stat_buffer == NULL || heatmap->slot_of_cpu == NULL) {
+        perror("malloc");
+        close_heatmap(heatmap);
+        return NULL;
+    }
+    if (heatmap->stat_fd == -1) {
+        fprintf(stderr, "Error opening /proc/stat\n");
+        close_heatmap(heatmap);
+        return NULL;
+    }
+
+    // Keep a descriptor per CPU so refreshes are a single pread each
+    int dirfd = open("/sys/devices/system/cpu", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    count_syscalls(1);
+    for (int cpu = 0; cpu <= heatmap->max_cpu; cpu++) {
+        heatmap->slot_of_cpu[cpu] = -1;
+    }
+    for (int cpu = cpuset_next(&online, 0); cpu >= 0; cpu = cpuset_next(&online, cpu + 1), index++) {
+        heatmap->cpus[index] = cpu;
+        heatmap->slot_of_cpu[cpu] = index;
+        heatmap->freq_fds[index] = dirfd == -1 ? -1 : open_cpu_file(dirfd, cpu, "scaling_cur_freq");
+
+        // The hardware maximum does not change, so it is read once
+        int max_fd = dirfd == -1 ? -1 : open_cpu_file(dirfd, cpu, "cpuinfo_max_freq");
+        heatmap->max_freq[index] = pread_number(max_fd);
+        if (max_fd != -1) {
+            close(max_fd);
+            count_syscalls(1);
+        }
+    }
+    if (dirfd != -1) {
+        close(dirfd);
+        count_syscalls(1);
+    }
+
+    return heatmap;
+}
+
+// Function to refresh frequencies and utilization since the previous sample
+int sample_heatmap (Heatmap *heatmap)
+{
+    for (int i = 0; i < heatmap->cpu_count; i++) {
+        heatmap->cur_freq[i] = pread_number(heatmap->freq_fds[i]);
+    }
+
+    ssize_t len = pread(heatmap->stat_fd, heatmap->stat_buffer, heatmap->stat_size - 1, 0);
+    count_syscalls(1);
+    if (len <= 0) {
+        return -1;
+    }
+    heatmap->stat_buffer[len] = '\0';
+
+    // Parse the "cpuN user nice system idle iowait irq softirq steal" lines
+    char *line = strchr(heatmap->stat_buffer, '\n');
+    while (line && strncmp(line + 1, "cpu", 3) == 0) {
+        char *cursor = line + 4;
+        int cpu = (int)strtol(cursor, &cursor, 10);
+
+        unsigned long long fields[8] = {0}, total = 0;
+        for (int f = 0; f < 8; f++) {
+            fields[f] = strtoull(cursor, &cursor, 10);
+            total += fields[f];
+        }
+        unsigned long long busy = total - fields[3] - fields[4];
+
+        if (cpu >= 0 && cpu <= heatmap->max_cpu && heatmap->slot_of_cpu[cpu] >= 0) {
+            int i = heatmap->slot_of_cpu[cpu];
+            unsigned long long delta_total = total - heatmap->prev_total[i];
+            heatmap->util[i] = delta_total ? (double)(busy - heatmap->prev_busy[i]) / delta_total : 0;
+            heatmap->prev_busy[i] = busy;
+            heatmap->prev_total[i] = total;
+        }
+        line = strchr(line + 1, '\n');
+    }
+
+    return 0;
+}
+
+// Function to blend between two colors
+static Color blend (const Color *from, const Color *to, double t)
+{
+    if (t < 0) {
+        t = 0;
+    } else if (t > 1) {
+        t = 1;
+    }
+    Color color = {
+        (unsigned char)(from->r + (to->r - from->r) * t),
+        (unsigned char)(from->g + (to->g - from->g) * t),
+        (unsigned char)(from->b + (to->b - from->b) * t)
+    };
+    return color;
+}
+
+// Function to render the heatmap as rows of half block cells, utilization on the
+// top half and frequency relative to the CPU maximum on the bottom half
+char *render_heatmap (const Heatmap *heatmap, const Color *base_color, const Color *accent_color)
+{
+    int rows = (heatmap->cpu_count + HEATMAP_ROW_CELLS - 1) / HEATMAP_ROW_CELLS;
+    size_t size = (size_t)heatmap->cpu_count * HEATMAP_CELL_SIZE + (size_t)rows * 16 + 512;
+    char *output = malloc(size);
+    if (output == NULL) {
+        perror("malloc");
+        return NULL;
+    }
+
+    // Summarize the average frequency and utilization
+    double util_total = 0, freq_total = 0;
+    int freq_count = 0;
+    for (int i = 0; i < heatmap->cpu_count; i++) {
+        util_total += heatmap->util[i];
+        if (heatmap->cur_freq[i] > 0) {
+            freq_total += heatmap->cur_freq[i];
+            freq_count++;
+        }
+    }
+    size_t len = 0;
+    len += snprintf(output + len, size - len, "\033[38;2;%d;%d;%dmCores: \033[38;2;%d;%d;%dm%d, %.0f%% busy",
+                    accent_color->r, accent_color->g, accent_color->b, base_color->r, base_color->g, base_color->b,
+                    heatmap->cpu_count, util_total * 100 / heatmap->cpu_count);
+    if (freq_count > 0) {
+        len += snprintf(output + len, size - len, " @ %.2fGHz avg", freq_total / freq_count / 1e6);
+    }
+    len += snprintf(output + len, size - len, " (top: load, bottom: frequency)\033[0m\n");
+
+    for (int i = 0; i < heatmap->cpu_count; i++) {
+        Color top = blend(&IDLE_COLOR, &BUSY_COLOR, heatmap->util[i]);
+        Color bottom = NO_DATA_COLOR;
+        if (heatmap->cur_freq[i] > 0 && heatmap->max_freq[i] > 0) {
+            bottom = blend(&NO_DATA_COLOR, accent_color, (double)heatmap->cur_freq[i] / heatmap->max_freq[i]);
+        }
+
+        if (i % HEATMAP_ROW_CELLS == 0) {
+            len += snprintf(output + len, size - len, " ");
+        }
+        len += snprintf(output + len, size - len, "\033[38;2;%d;%d;%d;48;2;%d;%d;%dm" HEATMAP_CELL,
+                        top.r, top.g, top.b, bottom.r, bottom.g, bottom.b);
+        if (i % HEATMAP_ROW_CELLS == HEATMAP_ROW_CELLS - 1 || i == heatmap->cpu_count - 1) {
+            len += snprintf(output + len, size - len, "\033[0m\n");
+        }
+    }
+
+    return output;
+}
+
+// Function to close every descriptor and free the heatmap
+void close_heatmap (Heatmap *heatmap)
+{
+    if (heatmap == NULL) {
+        return;
+    }
+    for (int i = 0; heatmap->freq_fds && i < heatmap->cpu_count; i++) {
+        if (heatmap->freq_fds[i] != -1) {
+            close(heatmap->freq_fds[i]);
+        }
+    }
+    if (heatmap->stat_fd != -1) {
+        close(heatmap->stat_fd);
+    }
+    free(heatmap->cpus);
+    free(heatmap->freq_fds);
+    free(heatmap->max_freq);
+    free(heatmap->cur_freq);
+    free(heatmap->prev_busy);
+    free(heatmap->prev_total);
+    free(heatmap->util);
+    free(heatmap->slot_of_cpu);
+    free(heatmap->stat_buffer);
+    free(heatmap);
+}
@@ -0,0 +1,404 @@
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "history.h"
+
+#define HISTORY_MAGIC "SGHIST01"
+#define HISTORY_VERSION 2
+#define HISTORY_HEADER_SIZE 4096
+#define HISTORY_BLOCK_SIZE 4096
+#define HISTORY_BLOCK_COUNT 256
+#define HISTORY_BLOCK_PREFIX sizeof(uint16_t)
+#define HISTORY_RECORD_MAX (HISTORY_FIELD_COUNT * 10)
+#define HISTORY_LOAD_SCALE 100
+#define HISTORY_PRESSURE_SCALE 100
+
+// On-disk header, followed by a ring of fixed-size blocks. Each block holds a
+// used byte count and a run of records encoded as zigzag varint deltas, where
+// the first record of a block is relative to zero so blocks decode on their own.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t field_count;
+    uint32_t block_size;
+    uint32_t block_count;
+    uint32_t head;
+    uint32_t blocks_used;
+    uint64_t sample_count;
+    int64_t last[HISTORY_FIELD_COUNT];
+} HistoryHeader;
+
+struct History {
+    int fd;
+    size_t size;
+    unsigned char *map;
+    HistoryHeader *header;
+};
+
+static const char *SPARK_LEVELS[] = {"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+
+// Function to get a pointer to a block in the ring
+static unsigned char *get_block (const History *history, uint32_t index)
+{
+    return history->map + HISTORY_HEADER_SIZE + (size_t)index * history->header->block_size;
+}
+
+// Function to get or set the number of used bytes in a block
+static uint16_t get_block_used (const unsigned char *block)
+{
+    uint16_t used;
+    memcpy(&used, block, sizeof(used));
+    return used;
+}
+
+static void set_block_used (unsigned char *block, uint16_t used)
+{
+    memcpy(block, &used, sizeof(used));
+}
+
+// Function to encode a signed value as a zigzag varint, returns bytes written
+static size_t encode_varint (int64_t value, unsigned char *out)
+{
+    uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    size_t len = 0;
+
+    while (zigzag >= 0x80) {
+        out[len++] = (unsigned char)(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    out[len++] = (unsigned char)zigzag;
+    return len;
+}
+
+// Function to decode a zigzag varint, returns bytes read or 0 if truncated
+static size_t decode_varint (const unsigned char *in, size_t available, int64_t *value)
+{
+    uint64_t zigzag = 0;
+    size_t len = 0;
+    int shift = 0;
+
+    while (len < available && shift < 64) {
+        unsigned char byte = in[len++];
+        zigzag |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+            return len;
+        }
+        shift += 7;
+    }
+    return 0;
+}
+
+// Function to encode a record as deltas from a base sample
+static size_t encode_record (const Sample *sample, const int64_t *base, unsigned char *out)
+{
+    size_t len = 0;
+    for (int i = 0; i < HISTORY_FIELD_COUNT; i++) {
+        len += encode_varint(sample->values[i] - (base ? base[i] : 0), out + len);
+    }
+    return len;
+}
+
+// Function to initialize the header and first block of a new history file
+static void init_history (History *history)
+{
+    HistoryHeader *header = history->header;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, HISTORY_MAGIC, sizeof(header->magic));
+    header->version = HISTORY_VERSION;
+    header->field_count = HISTORY_FIELD_COUNT;
+    header->block_size = HISTORY_BLOCK_SIZE;
+    header->block_count = HISTORY_BLOCK_COUNT;
+    header->head = 0;
+    header->blocks_used = 1;
+    set_block_used(get_block(history, 0), HISTORY_BLOCK_PREFIX);
+}
+
+// Function to open and map a history file, creating a preallocated one if requested
+History *open_history (const char *history_path, bool create)
+{
+    int fd = open(history_path, (create ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        fprintf(stderr, "Error opening history file: %s\n", history_path);
+        return NULL;
+    }
+
+    size_t size = HISTORY_HEADER_SIZE + (size_t)HISTORY_BLOCK_SIZE * HISTORY_BLOCK_COUNT;
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat");
+        close(fd);
+        return NULL;
+    }
+
+    // Preallocate the full ring so disk usage never grows after creation
+    bool fresh = false;
+    if (st.st_size == 0 && create) {
+        int err = posix_fallocate(fd, 0, size);
+        if (err != 0 && ftruncate(fd, size) == -1) {
+            perror("Failed to allocate history file");
+            close(fd);
+            return NULL;
+        }
+        fresh = true;
+    } else if ((size_t)st.st_size != size) {
+        fprintf(stderr, "Invalid history file: %s\n", history_path);
+        close(fd);
+        return NULL;
+    }
+
+    unsigned char *map = mmap(NULL, size, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        close(fd);
+        return NULL;
+    }
+
+    History *history = malloc(sizeof(History));
+    if (history == NULL) {
+        perror("malloc");
+        munmap(map, size);
+        close(fd);
+        return NULL;
+    }
+    history->fd = fd;
+    history->size = size;
+    history->map = map;
+    history->header = (HistoryHeader *)map;
+
+    if (fresh) {
+        init_history(history);
+    }
+
+    // Validate the layout of an existing file
+    HistoryHeader *header = history->header;
+    if (memcmp(header->magic, HISTORY_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != HISTORY_VERSION ||
+        header->field_count != HISTORY_FIELD_COUNT ||
+        header->block_size != HISTORY_BLOCK_SIZE ||
+        header->block_count != HISTORY_BLOCK_COUNT ||
+        header->head >= header->block_count ||
+        header->blocks_used == 0 || header->blocks_used > header->block_count) {
+        fprintf(stderr, "Incompatible history file: %s\n", history_path);
+        close_history(history);
+        return NULL;
+    }
+
+    return history;
+}
+
+// Function to unmap and close a history file
+void close_history (History *history)
+{
+    if (history == NULL) {
+        return;
+    }
+    munmap(history->map, history->size);
+    close(history->fd);
+    free(history);
+}
+
+// Function to collect the current values for a sample from a refreshed context
+int collect_sample (Sysgrab *sysgrab, Sample *sample)
+{
+    MemInfo mem;
+    double uptime = 0, load[3] = {0, 0, 0};
+    Pressure pressure[PRESSURE_COUNT];
+
+    memset(sample, 0, sizeof(*sample));
+    if (sysgrab_get_memory(sysgrab, &mem) != 0) {
+        return -1;
+    }
+    sysgrab_get_uptime(sysgrab, &uptime);
+    sysgrab_get_load(sysgrab, load);
+    sysgrab_get_pressure(sysgrab, pressure);
+
+    sample->values[HIST_TIME] = (int64_t)time(NULL);
+    sample->values[HIST_UPTIME] = (int64_t)uptime;
+    sample->values[HIST_MEM_TOTAL] = mem.total;
+    sample->values[HIST_MEM_FREE] = mem.free;
+    sample->values[HIST_MEM_BUFFERS] = mem.buffers;
+    sample->values[HIST_MEM_CACHED] = mem.cached;
+    sample->values[HIST_MEM_SHMEM] = mem.shmem;
+    sample->values[HIST_MEM_SRECLAIMABLE] = mem.sreclaimable;
+    sample->values[HIST_SWAP_TOTAL] = mem.swap_total;
+    sample->values[HIST_SWAP_FREE] = mem.swap_free;
+    for (int i = 0; i < 3; i++) {
+        sample->values[HIST_LOAD_1 + i] = (int64_t)(load[i] * HISTORY_LOAD_SCALE + 0.5);
+    }
+
+    // Kernels without pressure stall information record zero
+    for (int i = 0; i < PRESSURE_COUNT; i++) {
+        if (pressure[i].avg10 >= 0) {
+            sample->values[HIST_PRESSURE_CPU + i] = (int64_t)(pressure[i].avg10 * HISTORY_PRESSURE_SCALE + 0.5);
+        }
+    }
+    return 0;
+}
+
+// Function to append a sample to the ring, overwriting the oldest block when full
+int append_sample (History *history, const Sample *sample)
+{
+    HistoryHeader *header = history->header;
+    unsigned char record[HISTORY_RECORD_MAX];
+
+    // Serialize against other recorders writing to the same file
+    if (flock(history->fd, LOCK_EX) == -1) {
+        perror("flock");
+        return -1;
+    }
+
+    unsigned char *block = get_block(history, header->head);
+    uint16_t used = get_block_used(block);
+    size_t len = encode_record(sample, used > HISTORY_BLOCK_PREFIX ? header->last : NULL, record);
+
+    // Move to the next block when the record does not fit, starting it with an absolute record
+    if (used + len > header->block_size) {
+        header->head = (header->head + 1) % header->block_count;
+        if (header->blocks_used < header->block_count) {
+            header->blocks_used++;
+        }
+        block = get_block(history, header->head);
+        used = HISTORY_BLOCK_PREFIX;
+        set_block_used(block, used);
+        len = encode_record(sample, NULL, record);
+    }
+
+    // Write the record before publishing it through the used count
+    memcpy(block + used, record, len);
+    set_block_used(block, (uint16_t)(used + len));
+    memcpy(header->last, sample->values, sizeof(header->last));
+    header->sample_count++;
+
+    flock(history->fd, LOCK_UN);
+    return 0;
+}
+
+// Function to decode all samples in the ring from oldest to newest
+Sample *read_samples (History *history, size_t *sample_count)
+{
+    const HistoryHeader *header = history->header;
+    Sample *samples = NULL;
+    size_t count = 0, capacity = 0;
+
+    // Wait for an in-progress append to finish
+    flock(history->fd, LOCK_SH);
+
+    // The oldest block follows the head once the ring has wrapped
+    uint32_t oldest = 0;
+    if (header->blocks_used == header->block_count) {
+        oldest = (header->head + 1) % header->block_count;
+    }
+
+    for (uint32_t b = 0; b < header->blocks_used; b++) {
+        const unsigned char *block = get_block(history, (oldest + b) % header->block_count);
+        size_t used = get_block_used(block);
+        if (used > header->block_size) {
+            break;
+        }
+
+        int64_t current[HISTORY_FIELD_COUNT] = {0};
+        size_t offset = HISTORY_BLOCK_PREFIX;
+        while (offset < used) {
+            // Decode one record of deltas, dropping a truncated tail
+            bool complete = true;
+            for (int i = 0; i < HISTORY_FIELD_COUNT; i++) {
+                int64_t delta;
+                size_t len = decode_varint(block + offset, used - offset, &delta);
+                if (len == 0) {
+                    complete = false;
+                    break;
+                }
+                current[i] += delta;
+                offset += len;
+            }
+            if (!complete) {
+                break;
+            }
+
+            // Grow the output array as needed
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                Sample *new_samples = realloc(samples, capacity * sizeof(Sample));
+                if (new_samples == NULL) {
+                    perror("realloc");
+                    free(samples);
+                    flock(history->fd, LOCK_UN);
+                    return NULL;
+                }
+                samples = new_samples;
+            }
+            memcpy(samples[count].values, current, sizeof(current));
+            count++;
+        }
+    }
+
+    flock(history->fd, LOCK_UN);
+
+    *sample_count = count;
+    return samples;
+}
+
+// Function to compute the min, max and average of a series
+void summarize (const double *values, size_t count, Summary *summary)
+{
+    summary->min = summary->max = summary->avg = 0;
+    if (count == 0) {
+        return;
+    }
+
+    double total = 0;
+    summary->min = summary->max = values[0];
+    for (size_t i = 0; i < count; i++) {
+        if (values[i] < summary->min) {
+            summary->min = values[i];
+        }
+        if (values[i] > summary->max) {
+            summary->max = values[i];
+        }
+        total += values[i];
+    }
+    summary->avg = total / count;
+}
+
+// Function to draw a series as a sparkline of at most width cells
+char *make_sparkline (const double *values, size_t count, size_t width)
+{
+    if (count < width) {
+        width = count;
+    }
+
+    // Each level is a three byte UTF-8 block character
+    char *line = malloc(width * 3 + 1);
+    if (line == NULL) {
+        perror("malloc");
+        return NULL;
+    }
+    line[0] = '\0';
+
+    Summary summary;
+    summarize(values, count, &summary);
+    double range = summary.max - summary.min;
+    size_t level_count = sizeof(SPARK_LEVELS) / sizeof(SPARK_LEVELS[0]);
+
+    // Average the samples falling into each cell
+    for (size_t cell = 0; cell < width; cell++) {
+        size_t start = cell * count / width;
+        size_t end = (cell + 1) * count / width;
+        double total = 0;
+        for (size_t i = start; i < end; i++) {
+            total += values[i];
+        }
+        double avg = total / (end - start);
+
+        size_t level = range > 0 ? (size_t)((avg - summary.min) / range * (level_count - 1) + 0.5) : 0;
+        strcat(line, SPARK_LEVELS[level]);
+    }
+
+    return line;
+}
@@ -0,0 +1,315 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+#include "io.h"
+
+#ifdef HAVE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#define URING_OPS_PER_FILE 3
+#define URING_MAX_FILES 32
+
+// Number of syscalls the read paths count for themselves, used by the benchmark.
+// Calls made without a count_syscalls next to them, e.g. inside libc, are missed.
+static atomic_ulong syscall_count = 0;
+
+// Function to add to the syscall counter
+void count_syscalls (unsigned long count)
+{
+    atomic_fetch_add_explicit(&syscall_count, count, memory_order_relaxed);
+}
+
+// Function to get the syscall counter
+unsigned long get_syscall_count (void)
+{
+    return atomic_load_explicit(&syscall_count, memory_order_relaxed);
+}
+
+// Function to read a whole /proc or /sys file into a buffer with a single read
+ssize_t read_file_buffer (const char *file_path, char *buffer, size_t size)
+{
+    return read_file_at(AT_FDCWD, file_path, buffer, size);
+}
+
+// Function to read a whole file relative to a directory descriptor
+ssize_t read_file_at (int dirfd, const char *file_path, char *buffer, size_t size)
+{
+    int fd = openat(dirfd, file_path, O_RDONLY | O_CLOEXEC);
+    count_syscalls(1);
+    if (fd == -1) {
+        return -1;
+    }
+
+    // Pseudo files are generated in full on the first read
+    ssize_t len = read(fd, buffer, size - 1);
+    close(fd);
+    count_syscalls(2);
+    if (len < 0) {
+        return -1;
+    }
+
+    buffer[len] = '\0';
+    return len;
+}
+
+// Function to read a batch of files one after another
+void read_files_sync (FileRead *reads, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        reads[i].len = read_file_buffer(reads[i].path, reads[i].buffer, reads[i].size);
+    }
+}
+
+#ifdef HAVE_IO_URING
+// Type for the mapped rings of an io_uring instance
+typedef struct {
+    int fd;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    struct io_uring_params params;
+} Ring;
+
+// Function to release a ring and its mappings
+static void close_ring (Ring *ring)
+{
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+        count_syscalls(1);
+    }
+    if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_size);
+        count_syscalls(1);
+    }
+    if (ring->sq_ptr) {
+        munmap(ring->sq_ptr, ring->sq_size);
+        count_syscalls(1);
+    }
+    close(ring->fd);
+    count_syscalls(1);
+}
+
+// Function to set up a ring with room for the given number of submissions
+static int open_ring (Ring *ring, unsigned entries)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &ring->params);
+    count_syscalls(1);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    const struct io_uring_params *p = &ring->params;
+    ring->sq_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    ring->cq_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+
+    // Newer kernels share one mapping for both rings
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_size > ring->sq_size) {
+            ring->sq_size = ring->cq_size;
+        }
+        ring->cq_size = ring->sq_size;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    count_syscalls(1);
+    if (ring->sq_ptr == MAP_FAILED) {
+        ring->sq_ptr = NULL;
+        close_ring(ring);
+        return -1;
+    }
+
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        count_syscalls(1);
+        if (ring->cq_ptr == MAP_FAILED) {
+            ring->cq_ptr = NULL;
+            close_ring(ring);
+            return -1;
+        }
+    }
+
+    ring->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    count_syscalls(1);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        close_ring(ring);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Function to check that the kernel opens into direct descriptor slots. Older
+// kernels ignore file_index and hand out a normal descriptor instead, so support
+// is inferred from IORING_OP_LINKAT, which arrived in the same release (5.15).
+static int supports_direct_open (const Ring *ring)
+{
+    struct {
+        struct io_uring_probe probe;
+        struct io_uring_probe_op ops[IORING_OP_LINKAT + 1];
+    } buffer;
+    memset(&buffer, 0, sizeof(buffer));
+
+    int ret = (int)syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, &buffer.probe, IORING_OP_LINKAT + 1);
+    count_syscalls(1);
+    return ret >= 0 && buffer.probe.last_op >= IORING_OP_LINKAT &&
+           (buffer.probe.ops[IORING_OP_LINKAT].flags & IO_URING_OP_SUPPORTED);
+}
+
+// Function to read a batch of files with one io_uring submission. Each file is
+// an open, read and close chain linked through a direct descriptor slot, so the
+// whole batch costs a single io_uring_enter. Returns -1 if io_uring is unusable.
+int read_files_uring (FileRead *reads, size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    if (count > URING_MAX_FILES) {
+        return -1;
+    }
+
+    Ring ring;
+    unsigned entries = (unsigned)(count * URING_OPS_PER_FILE);
+    if (open_ring(&ring, entries) != 0) {
+        return -1;
+    }
+    if (!supports_direct_open(&ring)) {
+        close_ring(&ring);
+        return -1;
+    }
+
+    // Register an empty table of direct descriptors for the opened files
+    int slots[URING_MAX_FILES];
+    for (size_t i = 0; i < count; i++) {
+        slots[i] = -1;
+    }
+    int ret = (int)syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_FILES, slots, (unsigned)count);
+    count_syscalls(1);
+    if (ret < 0) {
+        close_ring(&ring);
+        return -1;
+    }
+
+    unsigned char *sq = ring.sq_ptr;
+    unsigned *sq_array = (unsigned *)(sq + ring.params.sq_off.array);
+    unsigned *sq_tail = (unsigned *)(sq + ring.params.sq_off.tail);
+
+    // Queue an open, read and close chain for every file
+    unsigned n = 0;
+    for (size_t i = 0; i < count; i++) {
+        reads[i].len = -1;
+
+        struct io_uring_sqe *sqe = &ring.sqes[n];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long)reads[i].path;
+        // Direct descriptors never reach the file table, so O_CLOEXEC is rejected
+        sqe->open_flags = O_RDONLY;
+        sqe->file_index = (unsigned)i + 1;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = i * URING_OPS_PER_FILE;
+        sq_array[n] = n;
+        n++;
+
+        sqe = &ring.sqes[n];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = (int)i;
+        sqe->addr = (unsigned long)reads[i].buffer;
+        sqe->len = (unsigned)(reads[i].size - 1);
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+        sqe->user_data = i * URING_OPS_PER_FILE + 1;
+        sq_array[n] = n;
+        n++;
+
+        sqe = &ring.sqes[n];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->file_index = (unsigned)i + 1;
+        sqe->user_data = i * URING_OPS_PER_FILE + 2;
+        sq_array[n] = n;
+        n++;
+    }
+    atomic_store_explicit((_Atomic unsigned *)sq_tail, n, memory_order_release);
+
+    // Submit everything and wait for every completion in one call
+    ret = (int)syscall(__NR_io_uring_enter, ring.fd, n, n, IORING_ENTER_GETEVENTS, NULL, 0);
+    count_syscalls(1);
+    if (ret < 0) {
+        close_ring(&ring);
+        return -1;
+    }
+
+    // Reap the completions and record the read results
+    unsigned char *cq = ring.cq_ptr;
+    unsigned *cq_head = (unsigned *)(cq + ring.params.cq_off.head);
+    unsigned *cq_tail = (unsigned *)(cq + ring.params.cq_off.tail);
+    unsigned cq_mask = *(unsigned *)(cq + ring.params.cq_off.ring_mask);
+    struct io_uring_cqe *cqes = (struct io_uring_cqe *)(cq + ring.params.cq_off.cqes);
+
+    unsigned head = *cq_head;
+    unsigned tail = atomic_load_explicit((_Atomic unsigned *)cq_tail, memory_order_acquire);
+    bool unsupported = false;
+    bool opened[URING_MAX_FILES] = {false};
+    for (; head != tail; head++) {
+        const struct io_uring_cqe *cqe = &cqes[head & cq_mask];
+        size_t i = cqe->user_data / URING_OPS_PER_FILE;
+        unsigned op = cqe->user_data % URING_OPS_PER_FILE;
+
+        if (op == 0 && cqe->res == -EINVAL) {
+            // Kernels before 5.15 cannot open into direct descriptors
+            unsupported = true;
+        } else if (op == 0 && cqe->res > 0) {
+            // A direct open completes with 0, anything else is a normal descriptor
+            // the kernel opened outside the slot table
+            close(cqe->res);
+            count_syscalls(1);
+            unsupported = true;
+        } else if (op == 0 && cqe->res == 0) {
+            opened[i] = true;
+        } else if (op == 1 && cqe->res >= 0) {
+            reads[i].len = cqe->res;
+            reads[i].buffer[cqe->res] = '\0';
+        } else if (op == 1 && (cqe->res == -EBADF || cqe->res == -ECANCELED)) {
+            // The read did not find the slot its open filled. A read cancelled
+            // because its own open failed is a missing file, not a broken ring.
+            unsupported = unsupported || cqe->res == -EBADF || opened[i];
+        }
+    }
+    atomic_store_explicit((_Atomic unsigned *)cq_head, head, memory_order_release);
+
+    close_ring(&ring);
+    return unsupported ? -1 : 0;
+}
+#else
+int read_files_uring (FileRead *reads, size_t count)
+{
+    (void)reads;
+    (void)count;
+    return -1;
+}
+#endif
+
+// Function to read a batch of files with the given backend, falling back to plain
+// reads when io_uring is not available or cannot open into direct slots. Returns
+// the backend that did the reads, so callers can stop retrying io_uring.
+IoBackend read_files (FileRead *reads, size_t count, IoBackend backend)
+{
+    if (backend == IO_URING && read_files_uring(reads, count) == 0) {
+        return IO_URING;
+    }
+    read_files_sync(reads, count);
+    return IO_SYNC;
+}
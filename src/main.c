@@ -1,48 +1,64 @@
 #include <getopt.h>
-#include <libgen.h>
+#include <limits.h>
+#include <time.h>
 
+#include "sysgrab.h"
 #include "data.h"
+#include "template.h"
+#include "paint.h"
 #include "config.h"
 #include "art.h"
+#include "history.h"
+#include "cgroup.h"
+#include "heatmap.h"
+#include "numa.h"
+#include "defaults.h"
 
 #define VERSION "0.0.1"
-#define ART_FILE_PATH "art.txt"
-#define CONFIG_FILE_PATH "config.txt"
 #define MAX_PATH 1024
-#define ERROR_MSG "not found"
-
-// Type for an rgb color
-typedef struct {
-    unsigned char r;
-    unsigned char g;
-    unsigned char b;
-} Color; 
-
-void get_executable_path (char *exe_path, size_t size);
+#define DEFAULT_HISTORY_WINDOW 300
+#define SPARKLINE_WIDTH 30
+#define DATA_ROW_SIZE 256
+#define DATA_ROW_FORMAT_SIZE 64
+#define CGROUP_ROW_SIZE (PATH_MAX + DATA_ROW_FORMAT_SIZE)
+#define BENCHMARK_RUNS 1000
+#define DEFAULT_CGROUP_COUNT 5
+#define HEATMAP_SAMPLE_USEC 200000
+#define STARTUP_SYSCALL_BUDGET 16
+
+void apply_config (const char *contents, Color *base_color, Color *accent_color, ArtStyle *art_style, Template **template);
+int init_resources (void);
 void show_help (const char *program_name);
-void print_sysgrab (const Color *base_color, const Color *accent_color, char **art, const size_t *max_line_len, const size_t *line_count);
-void print_line (const Color *base_color, const Color *accent_color, const size_t *max_line_len, char *art_string, char *info_type, char *info_string);
+void print_sysgrab (const Template *template, const Color *base_color, const Color *accent_color, const ArtStyle *art_style, char **art, size_t max_line_len, size_t line_count, SysgrabBackend backend);
+void print_line (const Color *base_color, const Color *accent_color, const size_t *max_line_len, const char *art_string, const char *info_type, const char *info_string);
+int record_history (const char *history_path, int interval);
+void print_history_row (const Color *base_color, const Color *accent_color, const char *info_type, const double *values, size_t count, const char *format);
+void print_history (const Color *base_color, const Color *accent_color, const char *history_path, int window);
+void benchmark_backend (const char *name, IoBackend backend);
+int run_benchmark (void);
+int compare_cgroup_memory (const void *a, const void *b);
+int compare_cgroup_cpu (const void *a, const void *b);
+void print_cgroups (const Color *base_color, const Color *accent_color, size_t top_count);
+int print_heatmap (const Color *base_color, const Color *accent_color, int interval);
+void print_numa (const Color *base_color, const Color *accent_color);
 
 int main (int argc, char *argv[]) 
 {
-    char exe_path[MAX_PATH];
     char art_path[MAX_PATH];
     char config_path[MAX_PATH];
-
-    // Get the path and directory of the executable
-    get_executable_path(exe_path, sizeof(exe_path));
-    char *exe_dir = dirname(exe_path);
-
-    // Construct the full paths to the resource files
-    snprintf(art_path, sizeof(art_path), "%s/art.txt", exe_dir);
-    snprintf(config_path, sizeof(config_path), "%s/config.txt", exe_dir);
-
-    // Check for and generate art/config files if they do not exist
-    generate_art_file(art_path);
-    generate_config_file(config_path);
+    char *base_value = NULL;
+    char *accent_value = NULL;
 
     int opt;
     int option_index = 0;
+    char *record_path = NULL;
+    char *history_path = NULL;
+    int interval = 0;
+    int window = DEFAULT_HISTORY_WINDOW;
+    int cgroup_count = 0;
+    bool heatmap = false;
+    bool numa = false;
+    SysgrabBackend backend = SYSGRAB_IO_SYNC;
 
     // Long options
     static struct option long_options[] = {
@@ -50,11 +66,21 @@ int main (int argc, char *argv[])
         {"version", no_argument, 0, 'v'},
         {"base-color", required_argument, 0, 'b'},
         {"accent-color", required_argument, 0, 'a'},
+        {"record", required_argument, 0, 'r'},
+        {"history", required_argument, 0, 'H'},
+        {"window", required_argument, 0, 'w'},
+        {"interval", required_argument, 0, 'i'},
+        {"benchmark", no_argument, 0, 'B'},
+        {"io-uring", no_argument, 0, 'U'},
+        {"cgroups", optional_argument, 0, 'c'},
+        {"heatmap", no_argument, 0, 'm'},
+        {"numa", no_argument, 0, 'n'},
+        {"init", no_argument, 0, 'I'},
         {0, 0, 0, 0}
     };
 
     // Switch for CLI arguments
-    while ((opt = getopt_long(argc, argv, "hvb:a:", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hvb:a:r:H:w:i:BUc::mnI", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'h':
                 show_help(argv[0]);
@@ -64,18 +90,58 @@ int main (int argc, char *argv[])
                 return EXIT_SUCCESS; 
             case 'b':
                 if (optarg) {
-                    edit_config("base_color", optarg, config_path);
+                    base_value = optarg;
                 } else {
                     printf("Usage: -b, --base-color [r,g,b]\n");
                 }  
                 break;
             case 'a':
                 if (optarg) {
-                    edit_config("accent_color", optarg, config_path);
+                    accent_value = optarg;
                 } else {
                     printf("Usage: -a, --accent-color [r,g,b]\n");
                 }
                 break;
+            case 'r':
+                record_path = optarg;
+                break;
+            case 'H':
+                history_path = optarg;
+                break;
+            case 'w':
+                window = atoi(optarg);
+                if (window <= 0) {
+                    fprintf(stderr, "Invalid window: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'i':
+                interval = atoi(optarg);
+                if (interval <= 0) {
+                    fprintf(stderr, "Invalid interval: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'c':
+                cgroup_count = optarg ? atoi(optarg) : DEFAULT_CGROUP_COUNT;
+                if (cgroup_count <= 0) {
+                    fprintf(stderr, "Invalid cgroup count: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'm':
+                heatmap = true;
+                break;
+            case 'n':
+                numa = true;
+                break;
+            case 'U':
+                backend = SYSGRAB_IO_URING;
+                break;
+            case 'B':
+                return run_benchmark() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+            case 'I':
+                return init_resources() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
             case '?':
                 fprintf(stderr, "Unknown option: %c\n", optopt);
                 return EXIT_FAILURE; 
@@ -83,49 +149,121 @@ int main (int argc, char *argv[])
                 return EXIT_FAILURE; 
         }
     }
-    
-    // Get config and parse
-    size_t config_count = 0;
-    Config *config = get_config(&config_count, config_path);
-    Color base_color, accent_color; 
-    if (config != NULL) {
-        // Parse specific settings
-        for (int i = 0; i < config_count; i++) {
-            if (strcmp(config[i].name, "base_color") == 0) {
-                sscanf(config[i].value, "%hhu,%hhu,%hhu", &base_color.r, &base_color.g, &base_color.b);
-            }
-            if (strcmp(config[i].name, "accent_color") == 0) {
-                sscanf(config[i].value, "%hhu,%hhu,%hhu", &accent_color.r, &accent_color.g, &accent_color.b);
-            }
+
+    // Load the user config, falling back to the built-in defaults
+    char *config_contents = load_resource(CONFIG_FILE_NAME, config_path, sizeof(config_path));
+    const char *config_text = config_contents ? config_contents : DEFAULT_CONFIG;
+
+    // Apply color edits, the only time a config file is written besides --init
+    const char *edits[][2] = {{"base_color", base_value}, {"accent_color", accent_value}};
+    for (size_t i = 0; i < sizeof(edits) / sizeof(edits[0]); i++) {
+        if (edits[i][1] == NULL) {
+            continue;
         }
-        free_config(config, config_count);
+        char *edited = edit_config(edits[i][0], edits[i][1], config_text, config_path, sizeof(config_path));
+        if (edited) {
+            free(config_contents);
+            config_contents = edited;
+            config_text = config_contents;
+        }
+    }
+
+    // Parse the defaults first so settings missing from the user config keep their default
+    Color base_color, accent_color; 
+    ArtStyle art_style = {0};
+    Template *template = NULL;
+    apply_config(DEFAULT_CONFIG, &base_color, &accent_color, &art_style, &template);
+    apply_config(config_text, &base_color, &accent_color, &art_style, &template);
+    free(config_contents);
+
+    // Record samples without rendering anything
+    if (record_path) {
+        free_template(template);
+        return record_history(record_path, interval) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Print a summary of recorded samples instead of the current values
+    if (history_path) {
+        free_template(template);
+        print_history(&base_color, &accent_color, history_path, window);
+        return EXIT_SUCCESS;
+    }
+
+    // Print the cgroups using the most resources instead of the current values
+    if (cgroup_count > 0) {
+        free_template(template);
+        print_cgroups(&base_color, &accent_color, cgroup_count);
+        return EXIT_SUCCESS;
     }
 
     // Get art, parse, and print sysgrab
     size_t max_line_len = 0, line_count = 0; 
-    char **art = get_art(&line_count, &max_line_len, art_path);
+    char *art_contents = load_resource(ART_FILE_NAME, art_path, sizeof(art_path));
+    char **art = get_art(&line_count, &max_line_len, art_contents ? art_contents : DEFAULT_ART);
+    free(art_contents);
+    if (template != NULL) {
+        print_sysgrab(template, &base_color, &accent_color, &art_style, art, max_line_len, line_count, backend);
+        free_template(template);
+    }
     if (art != NULL) {
-        print_sysgrab(&base_color, &accent_color, art, &max_line_len, &line_count);
         free_art(art, line_count);
-    } else {
-        print_sysgrab(&base_color, &accent_color, NULL, &max_line_len, NULL);
+    }
+
+    // Print the per-node memory breakdown under the art
+    if (numa) {
+        print_numa(&base_color, &accent_color);
+    }
+
+    // Print the per-core heatmap under the art, refreshing it every interval if given
+    if (heatmap) {
+        return print_heatmap(&base_color, &accent_color, interval) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
     return EXIT_SUCCESS;
 }
 
-// Function to get executable path
-void get_executable_path(char *exe_path, size_t size)
+// Function to parse the color settings and output layout from config contents.
+// The layout replaces the previous one only if the config has line entries.
+void apply_config (const char *contents, Color *base_color, Color *accent_color, ArtStyle *art_style, Template **template)
 {
-    ssize_t len = readlink("/proc/self/exe", exe_path, size - 1);
-    if (len != -1) {
-        exe_path[len] = '\0';
-    } else {
-        perror("Error finding executable path");
-        exit(EXIT_FAILURE);
+    size_t config_count = 0;
+    Config *config = get_config(&config_count, contents);
+    if (config != NULL) {
+        // Parse specific settings
+        for (size_t i = 0; i < config_count; i++) {
+            if (strcmp(config[i].name, "base_color") == 0) {
+                sscanf(config[i].value, "%hhu,%hhu,%hhu", &base_color->r, &base_color->g, &base_color->b);
+            }
+            if (strcmp(config[i].name, "accent_color") == 0) {
+                sscanf(config[i].value, "%hhu,%hhu,%hhu", &accent_color->r, &accent_color->g, &accent_color->b);
+            }
+            parse_art_style(config[i].name, config[i].value, art_style);
+        }
+
+        Template *lines = compile_config_template(config, config_count);
+        if (lines != NULL) {
+            free_template(*template);
+            *template = lines;
+        }
+        free_config(config, config_count);
     }
 }
 
+// Function to write the default config and art to the user config directory
+int init_resources (void)
+{
+    const char *resources[][2] = {{CONFIG_FILE_NAME, DEFAULT_CONFIG}, {ART_FILE_NAME, DEFAULT_ART}};
+    char path[MAX_PATH];
+
+    for (size_t i = 0; i < sizeof(resources) / sizeof(resources[0]); i++) {
+        if (write_resource(resources[i][0], resources[i][1], path, sizeof(path)) != 0) {
+            return -1;
+        }
+        printf("%s\n", path);
+    }
+    return 0;
+}
+
 // Function to print CLI help information
 void show_help (const char *program_name)
 {
@@ -136,129 +274,68 @@ void show_help (const char *program_name)
     printf("  -h, --help\t\t\tShow this help message and exit\n");
     printf("  -v, --version\t\t\tDisplay version information and exit\n");
     printf("  -b, --base-color [r,g,b]\tSet base color in the format r,g,b\n");
-    printf("  -a, --accent-color [r,g,b]\tSet accent color in the format r,g,b\n\n");
+    printf("  -a, --accent-color [r,g,b]\tSet accent color in the format r,g,b\n");
+    printf("  -r, --record [file]\t\tAppend a sample to a history file and exit\n");
+    printf("  -i, --interval [seconds]\tKeep recording or refreshing every interval seconds\n");
+    printf("  -H, --history [file]\t\tSummarize samples from a history file\n");
+    printf("  -w, --window [seconds]\tHistory window to summarize (default %d)\n", DEFAULT_HISTORY_WINDOW);
+    printf("  -c, --cgroups[=count]\t\tShow the cgroups using the most memory and CPU (default %d)\n", DEFAULT_CGROUP_COUNT);
+    printf("  -m, --heatmap\t\t\tShow per-core load and frequency, refreshed with --interval\n");
+    printf("  -n, --numa\t\t\tShow free memory and hugepages per NUMA node\n");
+    printf("  -U, --io-uring\t\tBatch file reads through io_uring when available\n");
+    printf("  -B, --benchmark\t\tCompare the file read backends and exit\n");
+    printf("  -I, --init\t\t\tWrite the default config and art to ~/.config/sysgrab and exit\n\n");
     printf("Examples:\n");
     printf("  %s\t\t\tDisplay sysfetch\n", program_name);
     printf("  %s -b 255,255,255\tSet base color to white\n", program_name);
-    printf("  %s --accent-color 0,0,0\tSet accent color to black\n\n", program_name);
+    printf("  %s --accent-color 0,0,0\tSet accent color to black\n", program_name);
+    printf("  %s -r hist.bin -i 1\tRecord a sample every second\n", program_name);
+    printf("  %s -H hist.bin -w 600\tSummarize the last ten minutes\n\n", program_name);
 }
 
-// Function to print sysgrab output
-void print_sysgrab (const Color *base_color, const Color *accent_color, char **art, const size_t *max_line_len, const size_t *line_count)
+// Function to print sysgrab output from the compiled layout
+void print_sysgrab (const Template *template, const Color *base_color, const Color *accent_color, const ArtStyle *art_style, char **art, size_t max_line_len, size_t line_count, SysgrabBackend backend)
 {
-    char *data_points[] = {
-        "OS: ",
-        "Architecture: ",
-        "Kernel: ",
-        "Host: ",
-        "Shell: ",
-        "Uptime: ",
-        "CPU: ",
-        "Memory: "
-    };
-
-    // If there is art
-    if (art != NULL) {
-        char *username, *hostname;
-
-        username = get_info(USERNAME);
-        hostname = get_info(HOSTNAME);
-        size_t user_host_len = 0;
-
-        if (username && hostname) {
-            // Add @ symbol to the username
-            strcat(username, "@");
-
-            // Create a string of dashes
-            user_host_len = strlen(username) + strlen(hostname) + 1;
-            char dashes[user_host_len + 1];
-            memset(dashes, '-', user_host_len);
-            dashes[user_host_len] = '\0';
-
-            // If there is at least one line of art
-            if (*line_count > 0)
-                print_line(base_color, accent_color, max_line_len, art[0], username, hostname);
-            else
-                print_line(base_color, accent_color, max_line_len, "", username, hostname);
-            
-            // If there is more than one line of art
-            if (*line_count > 1)
-                print_line(base_color, accent_color, max_line_len, art[1], "", dashes);
-            else
-                print_line(base_color, accent_color, max_line_len, "", "", dashes);
-
-            free(username);
-            free(hostname);
-        }
-
-        // Iterate through all datapoints and print system information
-        for (DataPoint dp = OS; dp <= MEMORY; dp++) {
-            char *info = get_info(dp);
-            // Check if the information has been fetched
-            if (info) {
-                // Check if there is remaining art
-                if (dp < *line_count) {
-                    print_line(base_color, accent_color, max_line_len, art[dp], data_points[dp - 2], info); 
-                } else {
-                    // Otherwise print with no art
-                    print_line(base_color, accent_color, max_line_len, "", data_points[dp - 2], info);
-                }
-            } else {
-                // Printing with an error message if information could not be fetched
-                if (dp < *line_count) {
-                    print_line(base_color, accent_color, max_line_len, art[dp], data_points[dp - 2], ERROR_MSG); 
-                } else {
-                    print_line(base_color, accent_color, max_line_len, "", data_points[dp - 2], ERROR_MSG);
-                }
-            }
-        }
-
-        // Print remaining lines of art if there
-        for (int i = 10; i < *line_count; i++) {
-            print_line(base_color, accent_color, max_line_len, art[i], "", "");
-        }
-    } else {
-        char *username, *hostname;
-
-        username = get_info(USERNAME);
-        hostname = get_info(HOSTNAME);
-        size_t user_host_len = 0;
-
-        if (username && hostname) {
-            // Add @ symbol to the username
-            strcat(username, "@");
-
-            // Create a string of dashes
-            user_host_len = strlen(username) + strlen(hostname) + 1;
-            char dashes[user_host_len + 1];
-            memset(dashes, '-', user_host_len);
-            dashes[user_host_len] = '\0';
+    const SysgrabDataPoint file_data_points[] = {SYSGRAB_OS, SYSGRAB_COMPUTER};
+    SysgrabDataPoint used_file_points[sizeof(file_data_points) / sizeof(file_data_points[0])];
+    size_t used_count = 0;
+
+    // The art color table only depends on the art size, so it is built once
+    ArtPaint *paint = create_art_paint(art_style, accent_color, art ? max_line_len : 0, art ? line_count : 0);
+    if (paint == NULL) {
+        return;
+    }
 
-            // Print username + hostname and dashes
-            print_line(base_color, accent_color, max_line_len, NULL, username, hostname);
-            print_line(base_color, accent_color, max_line_len, NULL, "", dashes);
+    Sysgrab *sysgrab = sysgrab_open();
+    if (sysgrab == NULL) {
+        free_art_paint(paint);
+        return;
+    }
 
-            free(username);
-            free(hostname);
+    // Read the files behind the static datapoints the layout uses in one batch
+    for (size_t i = 0; i < sizeof(file_data_points) / sizeof(file_data_points[0]); i++) {
+        if (template->fields & (1u << file_data_points[i])) {
+            used_file_points[used_count++] = file_data_points[i];
         }
+    }
+    sysgrab_set_backend(sysgrab, backend);
+    sysgrab_prefetch(sysgrab, used_file_points, used_count);
 
-        // Iterate through all datapoints and print system information
-        for (DataPoint dp = OS; dp <= MEMORY; dp++) {
-            char *info = get_info(dp);
-            if (info) {
-                print_line(base_color, accent_color, max_line_len, NULL, data_points[dp - 2], info);
-            } else {
-                print_line(base_color, accent_color, max_line_len, NULL, "", ERROR_MSG);
-            }
-        }
+    char *output = render_template(template, sysgrab, base_color, accent_color, art, line_count, paint);
+    if (output) {
+        fputs(output, stdout);
+        free(output);
     }
 
+    sysgrab_close(sysgrab);
+    free_art_paint(paint);
+
     // Add empty line for spacing at the end
     printf("\n");
 }
 
 // Function to print line
-void print_line(const Color *base_color, const Color *accent_color, const size_t *max_line_len, char *art_string, char *info_type, char *info_string)
+void print_line(const Color *base_color, const Color *accent_color, const size_t *max_line_len, const char *art_string, const char *info_type, const char *info_string)
 {
     // Change color to accent color
     printf("\033[38;2;%d;%d;%dm", accent_color->r, accent_color->g, accent_color->b);
@@ -279,4 +356,326 @@ void print_line(const Color *base_color, const Color *accent_color, const size_t
 
     // Reset color
     printf("\033[0m");
+}
+
+// Function to record samples into a history file, once or every interval seconds
+int record_history (const char *history_path, int interval)
+{
+    History *history = open_history(history_path, true);
+    if (history == NULL) {
+        return -1;
+    }
+    Sysgrab *sysgrab = sysgrab_open();
+    if (sysgrab == NULL) {
+        close_history(history);
+        return -1;
+    }
+
+    int status = 0;
+    do {
+        Sample sample;
+        sysgrab_refresh(sysgrab);
+        if (collect_sample(sysgrab, &sample) != 0 || append_sample(history, &sample) != 0) {
+            fprintf(stderr, "Failed to record sample\n");
+            status = -1;
+            break;
+        }
+    } while (interval > 0 && sleep(interval) == 0);
+
+    sysgrab_close(sysgrab);
+    close_history(history);
+    return status;
+}
+
+// Function to print one summarized series with a sparkline
+void print_history_row (const Color *base_color, const Color *accent_color, const char *info_type, const double *values, size_t count, const char *format)
+{
+    Summary summary;
+    summarize(values, count, &summary);
+    char *sparkline = make_sparkline(values, count, SPARKLINE_WIDTH);
+
+    // Build the format string, e.g. "%.0fMiB avg (%.0f min / %.0f max) %s"
+    char row_format[DATA_ROW_FORMAT_SIZE];
+    snprintf(row_format, sizeof(row_format), "%s avg (%s min / %s max) %%s", format, format, format);
+
+    char info[DATA_ROW_SIZE];
+    snprintf(info, sizeof(info), row_format, summary.avg, summary.min, summary.max, sparkline ? sparkline : "");
+    print_line(base_color, accent_color, NULL, NULL, info_type, info);
+
+    free(sparkline);
+}
+
+// Function to print min, max, average and sparklines over the recorded window
+void print_history (const Color *base_color, const Color *accent_color, const char *history_path, int window)
+{
+    History *history = open_history(history_path, false);
+    if (history == NULL) {
+        return;
+    }
+
+    size_t sample_count = 0;
+    Sample *samples = read_samples(history, &sample_count);
+    close_history(history);
+    if (samples == NULL || sample_count == 0) {
+        fprintf(stderr, "No samples in history file: %s\n", history_path);
+        free(samples);
+        return;
+    }
+
+    // Keep only the samples inside the window ending at the newest sample
+    int64_t end = samples[sample_count - 1].values[HIST_TIME];
+    size_t first = sample_count;
+    while (first > 0 && samples[first - 1].values[HIST_TIME] > end - window) {
+        first--;
+    }
+    size_t count = sample_count - first;
+
+    double *memory = malloc(count * sizeof(double));
+    double *swap = malloc(count * sizeof(double));
+    double *load = malloc(count * sizeof(double));
+    double *pressure[PRESSURE_COUNT];
+    int allocated = memory != NULL && swap != NULL && load != NULL;
+    for (int r = 0; r < PRESSURE_COUNT; r++) {
+        pressure[r] = malloc(count * sizeof(double));
+        allocated = allocated && pressure[r] != NULL;
+    }
+    if (!allocated) {
+        perror("malloc");
+        free(memory);
+        free(swap);
+        free(load);
+        for (int r = 0; r < PRESSURE_COUNT; r++) {
+            free(pressure[r]);
+        }
+        free(samples);
+        return;
+    }
+
+    // Derive the displayed series, using the same used memory formula as the Memory row
+    int reboots = 0;
+    for (size_t i = 0; i < count; i++) {
+        const int64_t *v = samples[first + i].values;
+        memory[i] = (v[HIST_MEM_TOTAL] + v[HIST_MEM_SHMEM] - v[HIST_MEM_FREE] - v[HIST_MEM_BUFFERS]
+                     - v[HIST_MEM_CACHED] - v[HIST_MEM_SRECLAIMABLE]) / 1024.0;
+        swap[i] = (v[HIST_SWAP_TOTAL] - v[HIST_SWAP_FREE]) / 1024.0;
+        load[i] = v[HIST_LOAD_1] / 100.0;
+        for (int r = 0; r < PRESSURE_COUNT; r++) {
+            pressure[r][i] = v[HIST_PRESSURE_CPU + r] / 100.0;
+        }
+        if (i > 0 && v[HIST_UPTIME] < samples[first + i - 1].values[HIST_UPTIME]) {
+            reboots++;
+        }
+    }
+
+    char info[DATA_ROW_SIZE];
+    snprintf(info, sizeof(info), "%llds window, %zu samples, %d reboot%s",
+             (long long)(end - samples[first].values[HIST_TIME]), count, reboots, reboots == 1 ? "" : "s");
+    print_line(base_color, accent_color, NULL, NULL, "History: ", info);
+    print_history_row(base_color, accent_color, "Memory: ", memory, count, "%.0fMiB");
+    print_history_row(base_color, accent_color, "Swap: ", swap, count, "%.0fMiB");
+    print_history_row(base_color, accent_color, "Load: ", load, count, "%.2f");
+    print_history_row(base_color, accent_color, "CPU pressure: ", pressure[PRESSURE_CPU], count, "%.1f%%");
+    print_history_row(base_color, accent_color, "Memory pressure: ", pressure[PRESSURE_MEMORY], count, "%.1f%%");
+    print_history_row(base_color, accent_color, "IO pressure: ", pressure[PRESSURE_IO], count, "%.1f%%");
+    printf("\n");
+
+    free(memory);
+    free(swap);
+    free(load);
+    for (int r = 0; r < PRESSURE_COUNT; r++) {
+        free(pressure[r]);
+    }
+    free(samples);
+}
+
+// Function to time collecting the file backed datapoints with a given backend
+void benchmark_backend (const char *name, IoBackend backend)
+{
+    const DataPoint file_points[] = {OS, COMPUTER, UPTIME, MEMORY};
+    const size_t point_count = sizeof(file_points) / sizeof(file_points[0]);
+
+    Prefetch *prefetch = malloc(sizeof(Prefetch));
+    if (prefetch == NULL) {
+        perror("malloc");
+        return;
+    }
+
+    // Check the backend works before timing it
+    if (prefetch_info(prefetch, backend, file_points, point_count) != backend) {
+        printf("  %-8s unavailable\n", name);
+        free(prefetch);
+        return;
+    }
+
+    struct timespec start, end;
+    unsigned long syscalls = get_syscall_count();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int run = 0; run < BENCHMARK_RUNS; run++) {
+        prefetch_info(prefetch, backend, file_points, point_count);
+        for (size_t i = 0; i < point_count; i++) {
+            free(get_info(prefetch, file_points[i]));
+        }
+        clear_prefetch(prefetch);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    syscalls = get_syscall_count() - syscalls;
+    free(prefetch);
+
+    double elapsed_us = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+    printf("  %-8s %8.1fus/run %6.1f counted syscalls/run\n", name, elapsed_us / BENCHMARK_RUNS, (double)syscalls / BENCHMARK_RUNS);
+}
+
+// Function to compare the synchronous and io_uring file read backends, and
+// check that loading the config and art stays within the startup syscall budget.
+// Syscalls are the ones the read paths count themselves, and the budget leaves
+// headroom over today's worst case of 12, a missing config directory.
+int run_benchmark (void)
+{
+    printf("Reading OS, Host, Uptime and Memory sources, %d runs:\n", BENCHMARK_RUNS);
+    benchmark_backend("sync", IO_SYNC);
+    benchmark_backend("io_uring", IO_URING);
+
+    char path[MAX_PATH];
+    unsigned long syscalls = get_syscall_count();
+    free(load_resource(CONFIG_FILE_NAME, path, sizeof(path)));
+    free(load_resource(ART_FILE_NAME, path, sizeof(path)));
+    syscalls = get_syscall_count() - syscalls;
+
+    printf("Startup: %lu counted syscalls loading config and art (budget %d)\n", syscalls, STARTUP_SYSCALL_BUDGET);
+    return syscalls <= STARTUP_SYSCALL_BUDGET ? 0 : -1;
+}
+
+// Function to order cgroups by current memory, largest first
+int compare_cgroup_memory (const void *a, const void *b)
+{
+    long long x = ((const CgroupStats *)a)->memory_current, y = ((const CgroupStats *)b)->memory_current;
+    return (x < y) - (x > y);
+}
+
+// Function to order cgroups by CPU time, largest first
+int compare_cgroup_cpu (const void *a, const void *b)
+{
+    long long x = ((const CgroupStats *)a)->cpu_usage_usec, y = ((const CgroupStats *)b)->cpu_usage_usec;
+    return (x < y) - (x > y);
+}
+
+// Function to print the cgroups using the most memory and CPU time
+void print_cgroups (const Color *base_color, const Color *accent_color, size_t top_count)
+{
+    char root[MAX_PATH];
+    if (find_cgroup_root(root, sizeof(root)) != 0) {
+        fprintf(stderr, "No cgroup v2 hierarchy found\n");
+        return;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t count = 0;
+    CgroupStats *cgroups = walk_cgroups(root, &count);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (cgroups == NULL) {
+        return;
+    }
+
+    // Rows hold a whole cgroup path, so they are sized for one rather than DATA_ROW_SIZE
+    char info[CGROUP_ROW_SIZE];
+    double elapsed_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    snprintf(info, sizeof(info), "%zu scanned under %s in %.1fms", count, root, elapsed_ms);
+    print_line(base_color, accent_color, NULL, NULL, "Cgroups: ", info);
+    if (top_count > count) {
+        top_count = count;
+    }
+
+    // The root cgroup covers the whole host, so it is left out of the rankings
+    qsort(cgroups, count, sizeof(CgroupStats), compare_cgroup_memory);
+    print_line(base_color, accent_color, NULL, NULL, "Memory:", "");
+    for (size_t i = 0, shown = 0; i < count && shown < top_count && cgroups[i].memory_current >= 0; i++) {
+        if (strcmp(cgroups[i].path, "/") == 0) {
+            continue;
+        }
+        snprintf(info, sizeof(info), "%8lldMiB  %s", cgroups[i].memory_current >> 20, cgroups[i].path);
+        print_line(base_color, accent_color, NULL, NULL, "", info);
+        shown++;
+    }
+
+    qsort(cgroups, count, sizeof(CgroupStats), compare_cgroup_cpu);
+    print_line(base_color, accent_color, NULL, NULL, "CPU:", "");
+    for (size_t i = 0, shown = 0; i < count && shown < top_count && cgroups[i].cpu_usage_usec >= 0; i++) {
+        if (strcmp(cgroups[i].path, "/") == 0) {
+            continue;
+        }
+        snprintf(info, sizeof(info), "%10.1fs  %s", cgroups[i].cpu_usage_usec / 1e6, cgroups[i].path);
+        print_line(base_color, accent_color, NULL, NULL, "", info);
+        shown++;
+    }
+    printf("\n");
+
+    free_cgroups(cgroups, count);
+}
+
+// Function to print the per-core heatmap once, or redraw it in place every interval seconds
+int print_heatmap (const Color *base_color, const Color *accent_color, int interval)
+{
+    Heatmap *heatmap = open_heatmap();
+    if (heatmap == NULL) {
+        return -1;
+    }
+
+    // Utilization is a delta, so take a baseline sample first
+    sample_heatmap(heatmap);
+    usleep(HEATMAP_SAMPLE_USEC);
+
+    int lines = 0;
+    do {
+        sample_heatmap(heatmap);
+        char *output = render_heatmap(heatmap, base_color, accent_color);
+        if (output == NULL) {
+            break;
+        }
+
+        // Move back over the previous frame before drawing the next one
+        if (lines > 0) {
+            printf("\033[%dA", lines);
+        }
+        fputs(output, stdout);
+        fflush(stdout);
+
+        lines = 0;
+        for (const char *c = output; *c; c++) {
+            lines += *c == '\n';
+        }
+        free(output);
+    } while (interval > 0 && sleep(interval) == 0);
+
+    close_heatmap(heatmap);
+    printf("\n");
+    return 0;
+}
+
+// Function to print free memory and hugepages for each NUMA node
+void print_numa (const Color *base_color, const Color *accent_color)
+{
+    char label[DATA_ROW_FORMAT_SIZE], info[DATA_ROW_SIZE];
+    size_t node_count = 0;
+    NodeMemInfo *nodes = read_numa_nodes(&node_count);
+
+    for (size_t i = 0; i < node_count; i++) {
+        snprintf(label, sizeof(label), "Node %d: ", nodes[i].node);
+        snprintf(info, sizeof(info), "%ldMiB free / %ldMiB, %ldMiB file, huge %ldMiB free / %ldMiB",
+                 nodes[i].free >> 10, nodes[i].total >> 10, nodes[i].file_pages >> 10,
+                 nodes[i].huge_free >> 10, nodes[i].huge_total >> 10);
+        print_line(base_color, accent_color, NULL, NULL, label, info);
+    }
+    free(nodes);
+
+    // Reservations are only tracked system wide
+    MemInfo mem;
+    if (read_meminfo(NULL, &mem) == 0) {
+        snprintf(info, sizeof(info), "%ld free / %ld, %ld reserved, %ldkB pages",
+                 mem.huge_free, mem.huge_total, mem.huge_rsvd, mem.huge_size);
+        print_line(base_color, accent_color, NULL, NULL, "Hugepages: ", info);
+    }
+    printf("\n");
 }
\ No newline at end of file
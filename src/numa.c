@@ -0,0 +1,137 @@
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "numa.h"
+#include "topology.h"
+#include "io.h"
+
+#define NUMA_BUFFER_SIZE 4096
+#define NUMA_PATH_SIZE (NAME_MAX + 32)
+#define NODE_SYSFS_PATH "/sys/devices/system/node"
+
+// Function to parse the "Node N Key: value kB" lines of a node meminfo
+static void parse_node_meminfo (const char *contents, NodeMemInfo *info)
+{
+    const struct {
+        const char *key;
+        long *value;
+    } fields[] = {
+        {"MemTotal:", &info->total},
+        {"MemFree:", &info->free},
+        {"FilePages:", &info->file_pages}
+    };
+    const size_t field_count = sizeof(fields) / sizeof(fields[0]);
+
+    size_t found = 0;
+    const char *line = contents;
+    while (line && *line && found < field_count) {
+        // Skip the "Node N " prefix
+        const char *key = strchr(line, ' ');
+        key = key ? strchr(key + 1, ' ') : NULL;
+        if (key) {
+            key++;
+            for (size_t i = 0; i < field_count; i++) {
+                size_t key_len = strlen(fields[i].key);
+                if (strncmp(key, fields[i].key, key_len) == 0) {
+                    *fields[i].value = strtol(key + key_len, NULL, 10);
+                    found++;
+                    break;
+                }
+            }
+        }
+
+        line = strchr(line, '\n');
+        if (line) {
+            line++;
+        }
+    }
+}
+
+// Function to add up the hugepages of every page size on a node, reading through the caller's buffer
+static void read_node_hugepages (int node_fd, NodeMemInfo *info, char *buffer, size_t size)
+{
+    int huge_fd = openat(node_fd, "hugepages", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    count_syscalls(1);
+    if (huge_fd == -1) {
+        return;
+    }
+    DIR *dir = fdopendir(huge_fd);
+    if (dir == NULL) {
+        close(huge_fd);
+        return;
+    }
+
+    // Directories are named after the page size, e.g. hugepages-2048kB
+    struct dirent *entry;
+    char path[NUMA_PATH_SIZE];
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "hugepages-", 10) != 0) {
+            continue;
+        }
+        long page_size = strtol(entry->d_name + 10, NULL, 10);
+
+        snprintf(path, sizeof(path), "%s/nr_hugepages", entry->d_name);
+        if (read_file_at(huge_fd, path, buffer, size) > 0) {
+            info->huge_total += strtol(buffer, NULL, 10) * page_size;
+        }
+        snprintf(path, sizeof(path), "%s/free_hugepages", entry->d_name);
+        if (read_file_at(huge_fd, path, buffer, size) > 0) {
+            info->huge_free += strtol(buffer, NULL, 10) * page_size;
+        }
+    }
+    closedir(dir);
+}
+
+// Function to read memory and hugepages for every online NUMA node
+NodeMemInfo *read_numa_nodes (size_t *node_count)
+{
+    // Parse buffer shared by every node, each node's meminfo is parsed before the next is read
+    char numa_buffer[NUMA_BUFFER_SIZE];
+    CpuSet online;
+    *node_count = 0;
+    if (read_file_buffer(NODE_SYSFS_PATH "/online", numa_buffer, sizeof(numa_buffer)) <= 0 ||
+        parse_cpulist(numa_buffer, &online) != 0) {
+        return NULL;
+    }
+
+    NodeMemInfo *nodes = calloc(cpuset_count(&online), sizeof(NodeMemInfo));
+    if (nodes == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+
+    int dirfd = open(NODE_SYSFS_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    count_syscalls(1);
+    if (dirfd == -1) {
+        free(nodes);
+        return NULL;
+    }
+
+    size_t count = 0;
+    char path[NUMA_PATH_SIZE];
+    for (int node = cpuset_next(&online, 0); node >= 0; node = cpuset_next(&online, node + 1)) {
+        snprintf(path, sizeof(path), "node%d", node);
+        int node_fd = openat(dirfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        count_syscalls(1);
+        if (node_fd == -1) {
+            continue;
+        }
+
+        NodeMemInfo *info = &nodes[count];
+        info->node = node;
+        if (read_file_at(node_fd, "meminfo", numa_buffer, sizeof(numa_buffer)) > 0) {
+            parse_node_meminfo(numa_buffer, info);
+        }
+        read_node_hugepages(node_fd, info, numa_buffer, sizeof(numa_buffer));
+        close(node_fd);
+        count_syscalls(1);
+        count++;
+    }
+    close(dirfd);
+    count_syscalls(1);
+
+    *node_count = count;
+    return nodes;
+}
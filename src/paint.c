@@ -0,0 +1,252 @@
+#include "paint.h"
+
+#define CUBE_LEVEL_COUNT 6
+#define GRAY_FIRST 232
+#define GRAY_COUNT 24
+#define GRADIENT_LEVELS 16
+
+// Channel values of the 6x6x6 color cube in the 256 color palette
+static const int CUBE_LEVELS[CUBE_LEVEL_COUNT] = {0, 95, 135, 175, 215, 255};
+
+// Function to pick the automatic color mode. Truecolor is kept unless COLORTERM
+// does not claim it and TERM names a 256 color terminal, as screen-256color
+// inside tmux or screen does.
+ColorMode resolve_color_mode (ColorMode mode)
+{
+    if (mode != COLOR_AUTO) {
+        return mode;
+    }
+
+    const char *colorterm = getenv("COLORTERM");
+    if (colorterm && (strstr(colorterm, "truecolor") || strstr(colorterm, "24bit"))) {
+        return COLOR_TRUECOLOR;
+    }
+    const char *term = getenv("TERM");
+    if (term && strstr(term, "256color") && !strstr(term, "direct")) {
+        return COLOR_256;
+    }
+    return COLOR_TRUECOLOR;
+}
+
+// Function to find the nearest cube level of a channel
+static int nearest_cube_level (int value)
+{
+    int best = 0;
+    for (int i = 1; i < CUBE_LEVEL_COUNT; i++) {
+        if (abs(CUBE_LEVELS[i] - value) < abs(CUBE_LEVELS[best] - value)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Function to get the squared distance between two colors
+static int color_distance (int r1, int g1, int b1, int r2, int g2, int b2)
+{
+    return (r1 - r2) * (r1 - r2) + (g1 - g2) * (g1 - g2) + (b1 - b2) * (b1 - b2);
+}
+
+// Function to get the closest entry of the 256 color palette, from the color cube or the gray ramp
+static int quantize_color (const Color *color)
+{
+    int r = nearest_cube_level(color->r), g = nearest_cube_level(color->g), b = nearest_cube_level(color->b);
+    int cube_distance = color_distance(color->r, color->g, color->b, CUBE_LEVELS[r], CUBE_LEVELS[g], CUBE_LEVELS[b]);
+
+    // The gray ramp runs from 8 to 238 in steps of 10
+    int average = (color->r + color->g + color->b) / 3;
+    int gray = average < 8 ? 0 : (average - 8) / 10;
+    gray = gray >= GRAY_COUNT ? GRAY_COUNT - 1 : gray;
+    int level = 8 + gray * 10;
+    int gray_distance = color_distance(color->r, color->g, color->b, level, level, level);
+
+    if (gray_distance < cube_distance) {
+        return GRAY_FIRST + gray;
+    }
+    return 16 + 36 * r + 6 * g + b;
+}
+
+// Function to precompute the escape sequence of a color in the given mode
+void make_paint_color (const Color *color, ColorMode mode, PaintColor *paint_color)
+{
+    int length;
+    if (mode == COLOR_256) {
+        int index = quantize_color(color);
+        paint_color->key = index;
+        length = snprintf(paint_color->escape, PAINT_ESCAPE_SIZE, "\033[38;5;%dm", index);
+    } else {
+        paint_color->key = (uint32_t)color->r << 16 | (uint32_t)color->g << 8 | color->b;
+        length = snprintf(paint_color->escape, PAINT_ESCAPE_SIZE, "\033[38;2;%d;%d;%dm", color->r, color->g, color->b);
+    }
+    paint_color->length = length;
+}
+
+// Function to write a precomputed escape unless the output already has that color
+size_t write_paint_color (char *output, const PaintColor *paint_color, uint32_t *current)
+{
+    if (*current == paint_color->key) {
+        return 0;
+    }
+    memcpy(output, paint_color->escape, paint_color->length);
+    *current = paint_color->key;
+    return paint_color->length;
+}
+
+// Function to parse an art coloring setting. Returns -1 if the setting is not
+// about art coloring or its value is not valid.
+int parse_art_style (const char *name, const char *value, ArtStyle *style)
+{
+    if (strcmp(name, "color_mode") == 0) {
+        if (strcmp(value, "truecolor") == 0) {
+            style->mode = COLOR_TRUECOLOR;
+        } else if (strcmp(value, "256") == 0) {
+            style->mode = COLOR_256;
+        } else if (strcmp(value, "auto") == 0) {
+            style->mode = COLOR_AUTO;
+        } else {
+            return -1;
+        }
+        return 0;
+    }
+
+    if (strcmp(name, "art_gradient") == 0) {
+        const char *names[] = {"none", "vertical", "horizontal", "diagonal"};
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strcmp(value, names[i]) == 0) {
+                style->gradient = (Gradient)i;
+                return 0;
+            }
+        }
+        return -1;
+    }
+
+    if (strcmp(name, "art_gradient_end") == 0) {
+        return sscanf(value, "%hhu,%hhu,%hhu", &style->end.r, &style->end.g, &style->end.b) == 3 ? 0 : -1;
+    }
+
+    // Colors for single characters are given as c:r,g,b
+    if (strcmp(name, "art_char_color") == 0) {
+        unsigned char c = value[0];
+        Color color;
+        if (c == '\0' || c >= PAINT_CHAR_COUNT || value[1] != ':' ||
+            sscanf(value + 2, "%hhu,%hhu,%hhu", &color.r, &color.g, &color.b) != 3) {
+            return -1;
+        }
+        style->has_char_color[c] = true;
+        style->char_colors[c] = color;
+        return 0;
+    }
+
+    return -1;
+}
+
+// Function to build the color table of an art size. Each gradient step gets its
+// color and escape once, so painting a line only compares keys and copies escapes.
+ArtPaint *create_art_paint (const ArtStyle *style, const Color *accent_color, size_t width, size_t height)
+{
+    ArtPaint *paint = calloc(1, sizeof(ArtPaint));
+    if (paint == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+    paint->mode = resolve_color_mode(style->mode);
+    paint->gradient = style->gradient;
+    paint->width = width;
+    paint->height = height;
+
+    // One step per row, per column or per diagonal
+    switch (style->gradient) {
+        case GRADIENT_VERTICAL:
+            paint->steps = height;
+            break;
+        case GRADIENT_HORIZONTAL:
+            paint->steps = width;
+            break;
+        case GRADIENT_DIAGONAL:
+            paint->steps = width + height - 1;
+            break;
+        default:
+            paint->steps = 1;
+            break;
+    }
+    if (paint->steps == 0 || paint->steps > width + height) {
+        paint->steps = 1;
+    }
+
+    paint->table = malloc(paint->steps * sizeof(PaintColor));
+    if (paint->table == NULL) {
+        perror("malloc");
+        free_art_paint(paint);
+        return NULL;
+    }
+
+    // Positions are rounded to a few levels so neighbouring cells share a color and
+    // its escape. Without a gradient the single step is the accent color.
+    for (size_t i = 0; i < paint->steps; i++) {
+        double t = paint->steps > 1 ? (double)i / (paint->steps - 1) : 0;
+        t = (int)(t * (GRADIENT_LEVELS - 1) + 0.5) / (double)(GRADIENT_LEVELS - 1);
+        Color color = {
+            accent_color->r + (style->end.r - accent_color->r) * t + 0.5,
+            accent_color->g + (style->end.g - accent_color->g) * t + 0.5,
+            accent_color->b + (style->end.b - accent_color->b) * t + 0.5
+        };
+        make_paint_color(&color, paint->mode, &paint->table[i]);
+    }
+
+    for (int c = 0; c < PAINT_CHAR_COUNT; c++) {
+        paint->has_char_color[c] = style->has_char_color[c];
+        if (style->has_char_color[c]) {
+            make_paint_color(&style->char_colors[c], paint->mode, &paint->char_colors[c]);
+        }
+    }
+
+    return paint;
+}
+
+// Function to write one line of art padded to the art width. An escape is only
+// written where the color changes, and blanks never change it, so runs of cells
+// with the same quantized color share one escape. Needs room for the padded line
+// plus one escape per character.
+size_t paint_art_line (const ArtPaint *paint, const char *line, size_t row, char *output, uint32_t *current)
+{
+    size_t len = 0, column = 0;
+    output[len++] = ' ';
+
+    for (const unsigned char *c = (const unsigned char *)line; *c; c++) {
+        // Bytes continuing a multibyte character stay with the character they belong to
+        if ((*c & 0xC0) == 0x80) {
+            output[len++] = *c;
+            continue;
+        }
+
+        if (*c != ' ' && *c != '\t') {
+            const PaintColor *color;
+            if (*c < PAINT_CHAR_COUNT && paint->has_char_color[*c]) {
+                color = &paint->char_colors[*c];
+            } else {
+                size_t step = paint->gradient == GRADIENT_VERTICAL ? row :
+                              paint->gradient == GRADIENT_HORIZONTAL ? column :
+                              paint->gradient == GRADIENT_DIAGONAL ? row + column : 0;
+                color = &paint->table[step < paint->steps ? step : paint->steps - 1];
+            }
+            len += write_paint_color(output + len, color, current);
+        }
+        output[len++] = *c;
+        column++;
+    }
+
+    // Pad by bytes like the rest of the layout, which lines up plain ASCII art
+    for (size_t i = strlen(line); i < paint->width + 2; i++) {
+        output[len++] = ' ';
+    }
+    return len;
+}
+
+// Function to free an art color table
+void free_art_paint (ArtPaint *paint)
+{
+    if (paint == NULL) {
+        return;
+    }
+    free(paint->table);
+    free(paint);
+}
@@ -0,0 +1,457 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pci.h"
+#include "config.h"
+#include "io.h"
+
+#define PCI_DEVICES_PATH "/sys/bus/pci/devices"
+#define PCI_INDEX_NAME "pci.idx"
+#define PCI_INDEX_MAGIC "SGPCI001"
+#define PCI_UEVENT_SIZE 512
+#define PCI_PATH_SIZE (NAME_MAX + 16)
+#define PCI_NAME_SIZE 96
+#define PCI_IDS_SIZE_LIMIT (16 * 1024 * 1024)
+
+// Places distributions install the pci.ids database
+static const char *PCI_IDS_PATHS[] = {
+    "/usr/share/hwdata/pci.ids",
+    "/usr/share/misc/pci.ids",
+    "/usr/share/pci.ids",
+    "/usr/local/share/pci.ids"
+};
+
+// Company suffixes dropped from vendor names
+static const char *VENDOR_SUFFIXES[] = {" Corporation", " Corp.", ", Inc.", " Inc.", " Co., Ltd.", " Ltd.", " GmbH", " AG"};
+
+// Function to list the display and network functions under /sys/bus/pci/devices.
+// The uevent file of each function has its class and IDs, so every function
+// costs one read relative to the directory. Returns the number of devices.
+size_t list_pci_devices (PciDevice *devices, size_t max_devices)
+{
+    size_t count = 0;
+    int dirfd = open(PCI_DEVICES_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    count_syscalls(1);
+    if (dirfd == -1) {
+        return 0;
+    }
+    DIR *dir = fdopendir(dirfd);
+    if (dir == NULL) {
+        close(dirfd);
+        return 0;
+    }
+
+    struct dirent *entry;
+    char path[PCI_PATH_SIZE], uevent[PCI_UEVENT_SIZE];
+    while ((entry = readdir(dir)) != NULL && count < max_devices) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/uevent", entry->d_name);
+        if (read_file_at(dirfd, path, uevent, sizeof(uevent)) <= 0) {
+            continue;
+        }
+
+        const char *class = strstr(uevent, "PCI_CLASS=");
+        const char *id = strstr(uevent, "PCI_ID=");
+        unsigned int class_code, vendor, device;
+        if (class == NULL || id == NULL || sscanf(class, "PCI_CLASS=%x", &class_code) != 1 ||
+            sscanf(id, "PCI_ID=%x:%x", &vendor, &device) != 2) {
+            continue;
+        }
+
+        // Display covers VGA, 3D and other display controllers
+        if (class_code >> 16 == PCI_CLASS_DISPLAY || class_code >> 16 == PCI_CLASS_NETWORK) {
+            devices[count].vendor = vendor;
+            devices[count].device = device;
+            devices[count].class = class_code;
+            count++;
+        }
+    }
+    closedir(dir);
+    count_syscalls(1);
+
+    return count;
+}
+
+// Function to parse four hex digits
+static int parse_hex4 (const char *text, uint16_t *value)
+{
+    unsigned int result = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = text[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0) {
+            return -1;
+        }
+        result = result << 4 | digit;
+    }
+    *value = result;
+    return 0;
+}
+
+// Function to compare index entries by key
+static int compare_entries (const void *a, const void *b)
+{
+    uint32_t key_a = ((const PciIndexEntry *)a)->key, key_b = ((const PciIndexEntry *)b)->key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+// Function to record the source of an index in its header
+static void set_index_source (PciIndexHeader *header, const struct stat *st)
+{
+    memcpy(header->magic, PCI_INDEX_MAGIC, sizeof(header->magic));
+    header->source_dev = st->st_dev;
+    header->source_ino = st->st_ino;
+    header->source_size = st->st_size;
+    header->source_mtime = st->st_mtim.tv_sec;
+    header->source_mtime_nsec = st->st_mtim.tv_nsec;
+}
+
+// Function to point a loaded index at its entries and names, -1 if the layout is not valid
+static int attach_index (PciIds *ids, const struct stat *source)
+{
+    const PciIndexHeader *header = ids->data;
+    if (ids->size < sizeof(PciIndexHeader) || memcmp(header->magic, PCI_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->source_dev != (uint64_t)source->st_dev || header->source_ino != (uint64_t)source->st_ino ||
+        header->source_size != (uint64_t)source->st_size || header->source_mtime != source->st_mtim.tv_sec ||
+        header->source_mtime_nsec != source->st_mtim.tv_nsec || header->names_size == 0 ||
+        ids->size != sizeof(PciIndexHeader) + (size_t)header->entry_count * sizeof(PciIndexEntry) + header->names_size) {
+        return -1;
+    }
+
+    ids->entries = (const PciIndexEntry *)(header + 1);
+    ids->entry_count = header->entry_count;
+    ids->names = (const char *)(ids->entries + ids->entry_count);
+    ids->names_size = header->names_size;
+
+    // Lookups copy names up to their terminator, which must stay inside the pool
+    return ids->names[ids->names_size - 1] == '\0' ? 0 : -1;
+}
+
+// Function to map the cached index if it was built from this pci.ids file
+static int map_cached_index (PciIds *ids, const struct stat *source)
+{
+    char path[PATH_MAX];
+    if (get_user_cache_path(PCI_INDEX_NAME, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    count_syscalls(1);
+    if (fd == -1) {
+        return -1;
+    }
+
+    struct stat st;
+    count_syscalls(1);
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(PciIndexHeader)) {
+        close(fd);
+        count_syscalls(1);
+        return -1;
+    }
+
+    ids->size = st.st_size;
+    ids->data = mmap(NULL, ids->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    count_syscalls(2);
+    if (ids->data == MAP_FAILED) {
+        ids->data = NULL;
+        return -1;
+    }
+    ids->mapped = true;
+
+    if (attach_index(ids, source) != 0) {
+        munmap(ids->data, ids->size);
+        count_syscalls(1);
+        ids->data = NULL;
+        ids->mapped = false;
+        return -1;
+    }
+    return 0;
+}
+
+// Function to append a name to the pool and an entry for it
+static int add_index_entry (PciIndexEntry **entries, size_t *entry_count, size_t *entry_capacity,
+                            char **names, size_t *names_size, size_t *names_capacity,
+                            uint32_t key, const char *name, size_t name_len)
+{
+    if (*entry_count == *entry_capacity) {
+        size_t capacity = *entry_capacity ? *entry_capacity * 2 : 4096;
+        PciIndexEntry *new_entries = realloc(*entries, capacity * sizeof(PciIndexEntry));
+        if (new_entries == NULL) {
+            perror("realloc");
+            return -1;
+        }
+        *entries = new_entries;
+        *entry_capacity = capacity;
+    }
+    if (*names_size + name_len + 1 > *names_capacity) {
+        size_t capacity = *names_capacity ? *names_capacity * 2 : 65536;
+        while (capacity < *names_size + name_len + 1) {
+            capacity *= 2;
+        }
+        char *new_names = realloc(*names, capacity);
+        if (new_names == NULL) {
+            perror("realloc");
+            return -1;
+        }
+        *names = new_names;
+        *names_capacity = capacity;
+    }
+
+    (*entries)[*entry_count].key = key;
+    (*entries)[*entry_count].name = *names_size;
+    (*entry_count)++;
+    memcpy(*names + *names_size, name, name_len);
+    *names_size += name_len;
+    (*names)[(*names_size)++] = '\0';
+    return 0;
+}
+
+// Function to build the index from the vendor and device lines of pci.ids.
+// Subsystem lines and the device class list at the end are left out.
+static int build_index (PciIds *ids, const char *source, size_t source_size, const struct stat *st)
+{
+    PciIndexEntry *entries = NULL;
+    char *names = NULL;
+    size_t entry_count = 0, entry_capacity = 0, names_size = 0, names_capacity = 0;
+    uint16_t vendor = 0;
+    bool in_vendor = false;
+    int status = 0;
+
+    const char *line = source, *end = source + source_size;
+    while (line < end && status == 0) {
+        const char *next = memchr(line, '\n', end - line);
+        size_t line_len = next ? (size_t)(next - line) : (size_t)(end - line);
+        uint16_t device;
+
+        if (line_len >= 2 && line[0] == 'C' && line[1] == ' ') {
+            break;
+        } else if (line_len > 6 && line[0] != '\t' && parse_hex4(line, &vendor) == 0 &&
+                   line[4] == ' ' && line[5] == ' ') {
+            in_vendor = true;
+            status = add_index_entry(&entries, &entry_count, &entry_capacity, &names, &names_size, &names_capacity,
+                                     (uint32_t)vendor << 16 | PCI_VENDOR_KEY, line + 6, line_len - 6);
+        } else if (line_len > 7 && in_vendor && line[0] == '\t' && line[1] != '\t' &&
+                   parse_hex4(line + 1, &device) == 0 && line[5] == ' ' && line[6] == ' ' && device != PCI_VENDOR_KEY) {
+            status = add_index_entry(&entries, &entry_count, &entry_capacity, &names, &names_size, &names_capacity,
+                                     (uint32_t)vendor << 16 | device, line + 7, line_len - 7);
+        } else if (line_len > 0 && line[0] != '\t' && line[0] != '#') {
+            in_vendor = false;
+        }
+        line = next ? next + 1 : end;
+    }
+
+    if (status == 0 && entry_count > 0) {
+        qsort(entries, entry_count, sizeof(PciIndexEntry), compare_entries);
+
+        // Lay the index out exactly as it is cached, so it can be written in one go
+        ids->size = sizeof(PciIndexHeader) + entry_count * sizeof(PciIndexEntry) + names_size;
+        ids->data = malloc(ids->size);
+        if (ids->data == NULL) {
+            perror("malloc");
+            status = -1;
+        } else {
+            PciIndexHeader *header = ids->data;
+            memset(header, 0, sizeof(PciIndexHeader));
+            set_index_source(header, st);
+            header->entry_count = entry_count;
+            header->names_size = names_size;
+            memcpy(header + 1, entries, entry_count * sizeof(PciIndexEntry));
+            memcpy((char *)(header + 1) + entry_count * sizeof(PciIndexEntry), names, names_size);
+            status = attach_index(ids, st);
+        }
+    } else {
+        status = -1;
+    }
+
+    free(entries);
+    free(names);
+    return status;
+}
+
+// Function to load the name index of a pci.ids file, mapped from the cache when
+// it was built from the same file, otherwise built once and cached. Returns NULL
+// if the file cannot be read.
+PciIds *load_pci_ids (const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    count_syscalls(1);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    struct stat st;
+    count_syscalls(1);
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size > PCI_IDS_SIZE_LIMIT) {
+        close(fd);
+        count_syscalls(1);
+        return NULL;
+    }
+
+    PciIds *ids = calloc(1, sizeof(PciIds));
+    if (ids == NULL) {
+        perror("calloc");
+        close(fd);
+        count_syscalls(1);
+        return NULL;
+    }
+
+    if (map_cached_index(ids, &st) == 0) {
+        close(fd);
+        count_syscalls(1);
+        return ids;
+    }
+
+    // The cache is missing or pci.ids was updated since it was built
+    char *source = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    count_syscalls(2);
+    if (source == MAP_FAILED) {
+        perror("mmap");
+        free(ids);
+        return NULL;
+    }
+
+    int status = build_index(ids, source, st.st_size, &st);
+    munmap(source, st.st_size);
+    count_syscalls(1);
+    if (status != 0) {
+        close_pci_ids(ids);
+        return NULL;
+    }
+
+    save_cache_data(PCI_INDEX_NAME, ids->data, ids->size);
+    return ids;
+}
+
+// Function to load the name index of the system pci.ids, NULL if it is not installed
+PciIds *open_pci_ids (void)
+{
+    for (size_t i = 0; i < sizeof(PCI_IDS_PATHS) / sizeof(PCI_IDS_PATHS[0]); i++) {
+        PciIds *ids = load_pci_ids(PCI_IDS_PATHS[i]);
+        if (ids) {
+            return ids;
+        }
+    }
+    return NULL;
+}
+
+// Function to look up the name of a device, or of the vendor with PCI_VENDOR_KEY
+// as the device. Returns NULL if it is not in the index.
+const char *find_pci_name (const PciIds *ids, uint16_t vendor, uint16_t device)
+{
+    if (ids == NULL) {
+        return NULL;
+    }
+
+    PciIndexEntry key = {(uint32_t)vendor << 16 | device, 0};
+    const PciIndexEntry *entry = bsearch(&key, ids->entries, ids->entry_count, sizeof(PciIndexEntry), compare_entries);
+    if (entry == NULL || entry->name >= ids->names_size) {
+        return NULL;
+    }
+    return ids->names + entry->name;
+}
+
+// Function to unmap or free an index
+void close_pci_ids (PciIds *ids)
+{
+    if (ids == NULL) {
+        return;
+    }
+    if (ids->mapped) {
+        munmap(ids->data, ids->size);
+        count_syscalls(1);
+    } else {
+        free(ids->data);
+    }
+    free(ids);
+}
+
+// Function to shorten a name to the part in brackets if it has one, like
+// "GA102 [GeForce RTX 3090]", otherwise to drop a company suffix
+static void short_pci_name (const char *name, char *result, size_t size)
+{
+    const char *open = strchr(name, '[');
+    const char *close = open ? strchr(open, ']') : NULL;
+    if (open && close && close > open + 1) {
+        snprintf(result, size, "%.*s", (int)(close - open - 1), open + 1);
+        return;
+    }
+
+    size_t len = strlen(name);
+    for (size_t i = 0; i < sizeof(VENDOR_SUFFIXES) / sizeof(VENDOR_SUFFIXES[0]); i++) {
+        size_t suffix_len = strlen(VENDOR_SUFFIXES[i]);
+        if (len > suffix_len && strcmp(name + len - suffix_len, VENDOR_SUFFIXES[i]) == 0) {
+            len -= suffix_len;
+            break;
+        }
+    }
+    snprintf(result, size, "%.*s", (int)len, name);
+}
+
+// Function to describe a device by name, falling back to its hex IDs where the
+// index has no name for it
+static void describe_pci_device (const PciDevice *device, const PciIds *ids, char *result, size_t size)
+{
+    const char *vendor_name = find_pci_name(ids, device->vendor, PCI_VENDOR_KEY);
+    const char *device_name = find_pci_name(ids, device->vendor, device->device);
+    char vendor_short[PCI_NAME_SIZE], device_short[PCI_NAME_SIZE];
+
+    if (vendor_name && device_name) {
+        short_pci_name(vendor_name, vendor_short, sizeof(vendor_short));
+        short_pci_name(device_name, device_short, sizeof(device_short));
+        snprintf(result, size, "%s %s", vendor_short, device_short);
+    } else if (vendor_name) {
+        short_pci_name(vendor_name, vendor_short, sizeof(vendor_short));
+        snprintf(result, size, "%s %04x", vendor_short, device->device);
+    } else {
+        snprintf(result, size, "%04x:%04x", device->vendor, device->device);
+    }
+}
+
+// Function to format the devices into a string like "NVIDIA GeForce RTX 3090,
+// 2x Intel I225-V", display devices first and identical devices counted once
+int format_pci_devices (const PciDevice *devices, size_t count, const PciIds *ids, char *buffer, size_t size)
+{
+    const uint32_t classes[] = {PCI_CLASS_DISPLAY, PCI_CLASS_NETWORK};
+    char name[PCI_NAME_SIZE * 2];
+    size_t len = 0;
+    buffer[0] = '\0';
+
+    for (size_t c = 0; c < sizeof(classes) / sizeof(classes[0]); c++) {
+        for (size_t i = 0; i < count && len < size; i++) {
+            if (devices[i].class >> 16 != classes[c]) {
+                continue;
+            }
+
+            // Count every identical device at its first occurrence
+            size_t same = 0;
+            bool seen = false;
+            for (size_t j = 0; j < count; j++) {
+                if (devices[j].vendor == devices[i].vendor && devices[j].device == devices[i].device) {
+                    seen = seen || j < i;
+                    same++;
+                }
+            }
+            if (seen) {
+                continue;
+            }
+
+            describe_pci_device(&devices[i], ids, name, sizeof(name));
+            if (same > 1) {
+                len += snprintf(buffer + len, size - len, "%s%zux %s", len ? ", " : "", same, name);
+            } else {
+                len += snprintf(buffer + len, size - len, "%s%s", len ? ", " : "", name);
+            }
+        }
+    }
+
+    return len > 0 ? (int)(len < size ? len : size - 1) : -1;
+}
@@ -0,0 +1,290 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "sensors.h"
+#include "config.h"
+#include "io.h"
+
+#define HWMON_CLASS_PATH "/sys/class/hwmon"
+#define BOOT_ID_PATH "/proc/sys/kernel/random/boot_id"
+#define SENSORS_CACHE_NAME "sensors"
+#define SENSOR_BUFFER_SIZE 64
+#define SENSOR_CACHE_SIZE (MAX_SENSORS * (SENSOR_PATH_SIZE + 8) + SENSOR_BUFFER_SIZE)
+#define MAX_FANS 4
+
+// Chips whose first temperature input is the CPU package or die
+static const char *CPU_CHIPS[] = {"coretemp", "k10temp", "zenpower", "cpu_thermal", "soc_thermal"};
+
+// Chips whose first temperature input is a drive
+static const char *DRIVE_CHIPS[] = {"drivetemp", "nvme"};
+
+// Function to check if a chip name is in a list
+static int chip_in (const char *name, const char **chips, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(name, chips[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to add an input to the list if the file exists under a hwmon directory
+static void add_input (int dirfd, const char *hwmon, const char *file, SensorKind kind, SensorInput *inputs, size_t *count)
+{
+    char path[SENSOR_PATH_SIZE];
+    if (*count >= MAX_SENSORS) {
+        return;
+    }
+
+    // Inputs whose path does not fit are skipped rather than read or cached truncated
+    int length = snprintf(inputs[*count].path, SENSOR_PATH_SIZE, HWMON_CLASS_PATH "/%s/%s", hwmon, file);
+    if (length < 0 || length >= SENSOR_PATH_SIZE) {
+        return;
+    }
+    snprintf(path, sizeof(path), "%s/%s", hwmon, file);
+    count_syscalls(1);
+    if (faccessat(dirfd, path, R_OK, 0) != 0) {
+        return;
+    }
+
+    inputs[*count].kind = kind;
+    (*count)++;
+}
+
+// Function to scan every hwmon chip for the CPU, drive, fan and power inputs
+static size_t discover_sensors (SensorInput *inputs)
+{
+    size_t count = 0;
+    int dirfd = open(HWMON_CLASS_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    count_syscalls(1);
+    if (dirfd == -1) {
+        return 0;
+    }
+    DIR *dir = fdopendir(dirfd);
+    if (dir == NULL) {
+        close(dirfd);
+        return 0;
+    }
+
+    struct dirent *entry;
+    char path[SENSOR_PATH_SIZE], name[SENSOR_BUFFER_SIZE];
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "hwmon", 5) != 0) {
+            continue;
+        }
+        int length = snprintf(path, sizeof(path), "%s/name", entry->d_name);
+        if (length < 0 || (size_t) length >= sizeof(path)) {
+            continue;
+        }
+        if (read_file_at(dirfd, path, name, sizeof(name)) <= 0) {
+            continue;
+        }
+        name[strcspn(name, "\n")] = '\0';
+
+        if (chip_in(name, CPU_CHIPS, sizeof(CPU_CHIPS) / sizeof(CPU_CHIPS[0]))) {
+            add_input(dirfd, entry->d_name, "temp1_input", SENSOR_CPU_TEMP, inputs, &count);
+        } else if (chip_in(name, DRIVE_CHIPS, sizeof(DRIVE_CHIPS) / sizeof(DRIVE_CHIPS[0]))) {
+            add_input(dirfd, entry->d_name, "temp1_input", SENSOR_DRIVE_TEMP, inputs, &count);
+        }
+
+        // Fans and power meters can be on any chip, e.g. a Super I/O or a GPU
+        for (int fan = 1; fan <= MAX_FANS; fan++) {
+            char file[SENSOR_BUFFER_SIZE];
+            snprintf(file, sizeof(file), "fan%d_input", fan);
+            add_input(dirfd, entry->d_name, file, SENSOR_FAN, inputs, &count);
+        }
+        size_t before = count;
+        add_input(dirfd, entry->d_name, "power1_input", SENSOR_POWER, inputs, &count);
+        if (count == before) {
+            add_input(dirfd, entry->d_name, "power1_average", SENSOR_POWER, inputs, &count);
+        }
+    }
+    closedir(dir);
+    count_syscalls(1);
+
+    return count;
+}
+
+// Function to parse the cached inputs, -1 if they were discovered in another boot
+static int parse_sensor_cache (const char *contents, const char *boot_id, SensorInput *inputs, size_t *count)
+{
+    size_t boot_id_len = strlen(boot_id);
+    if (strncmp(contents, boot_id, boot_id_len) != 0 || contents[boot_id_len] != '\n') {
+        return -1;
+    }
+
+    *count = 0;
+    const char *line = contents + boot_id_len + 1;
+    while (*line && *count < MAX_SENSORS) {
+        int kind;
+        char path[SENSOR_PATH_SIZE];
+        if (sscanf(line, "%d %95s", &kind, path) == 2 && kind >= 0 && kind < SENSOR_KIND_COUNT) {
+            inputs[*count].kind = kind;
+            snprintf(inputs[*count].path, SENSOR_PATH_SIZE, "%s", path);
+            (*count)++;
+        }
+
+        line = strchr(line, '\n');
+        if (line == NULL) {
+            break;
+        }
+        line++;
+    }
+    return 0;
+}
+
+// Function to save the discovered inputs under the current boot id
+static void save_sensor_cache (const char *boot_id, const SensorInput *inputs, size_t count)
+{
+    char contents[SENSOR_CACHE_SIZE];
+    size_t len = snprintf(contents, sizeof(contents), "%s\n", boot_id);
+    for (size_t i = 0; i < count; i++) {
+        len += snprintf(contents + len, sizeof(contents) - len, "%d %s\n", inputs[i].kind, inputs[i].path);
+    }
+    save_cache(SENSORS_CACHE_NAME, contents);
+}
+
+// Function to open every input, returns -1 if one of them has gone
+static int open_inputs (Sensors *sensors)
+{
+    for (size_t i = 0; i < sensors->count; i++) {
+        sensors->fds[i] = open(sensors->inputs[i].path, O_RDONLY | O_CLOEXEC);
+        count_syscalls(1);
+        if (sensors->fds[i] == -1 && (errno == ENOENT || errno == ENODEV)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Function to resolve and open the hwmon inputs, from the cache when it was written
+// in this boot, since hwmon numbering can change across boots. The inputs are
+// discovered again when the cache is stale or one of its paths has gone.
+int open_sensors (Sensors *sensors)
+{
+    memset(sensors, 0, sizeof(*sensors));
+    for (size_t i = 0; i < MAX_SENSORS; i++) {
+        sensors->fds[i] = -1;
+    }
+
+    char boot_id[SENSOR_BUFFER_SIZE];
+    if (read_file_buffer(BOOT_ID_PATH, boot_id, sizeof(boot_id)) <= 0) {
+        return -1;
+    }
+    boot_id[strcspn(boot_id, "\n")] = '\0';
+
+    char *cache = load_cache(SENSORS_CACHE_NAME);
+    int cached = cache != NULL && parse_sensor_cache(cache, boot_id, sensors->inputs, &sensors->count) == 0;
+    free(cache);
+    if (cached && open_inputs(sensors) == 0) {
+        return 0;
+    }
+
+    // A chip was unbound or reloaded, or the cache is from another boot
+    close_sensors(sensors);
+    sensors->count = discover_sensors(sensors->inputs);
+    save_sensor_cache(boot_id, sensors->inputs, sensors->count);
+    open_inputs(sensors);
+    return 0;
+}
+
+// Function to read every open input, temperatures in °C, fans in RPM and power in W.
+// Returns the number of readings.
+int sample_sensors (const Sensors *sensors, SensorReading *readings, size_t size)
+{
+    size_t count = 0;
+    char buffer[SENSOR_BUFFER_SIZE];
+    for (size_t i = 0; i < sensors->count && count < size; i++) {
+        if (sensors->fds[i] == -1) {
+            continue;
+        }
+
+        // hwmon regenerates an attribute on every read from offset zero
+        ssize_t len = pread(sensors->fds[i], buffer, sizeof(buffer) - 1, 0);
+        count_syscalls(1);
+        if (len <= 0) {
+            continue;
+        }
+        buffer[len] = '\0';
+
+        // hwmon reports millidegrees, RPM and microwatts
+        long value = strtol(buffer, NULL, 10);
+        readings[count].kind = (SysgrabSensorKind)sensors->inputs[i].kind;
+        switch (sensors->inputs[i].kind) {
+            case SENSOR_CPU_TEMP:
+            case SENSOR_DRIVE_TEMP:
+                readings[count].value = value / 1000.0;
+                break;
+            case SENSOR_POWER:
+                readings[count].value = value / 1e6;
+                break;
+            default:
+                readings[count].value = value;
+                break;
+        }
+        count++;
+    }
+
+    return (int)count;
+}
+
+// Function to close every open input
+void close_sensors (Sensors *sensors)
+{
+    for (size_t i = 0; i < MAX_SENSORS; i++) {
+        if (sensors->fds[i] != -1) {
+            close(sensors->fds[i]);
+            count_syscalls(1);
+            sensors->fds[i] = -1;
+        }
+    }
+}
+
+// Function to read the sensors once
+int read_sensors (SensorReading *readings, size_t size)
+{
+    Sensors sensors;
+    if (open_sensors(&sensors) != 0) {
+        return -1;
+    }
+    int count = sample_sensors(&sensors, readings, size);
+    close_sensors(&sensors);
+    return count;
+}
+
+// Function to format the hottest CPU and drive, fastest fan and total power,
+// e.g. "CPU 54°C, Drive 38°C, Fan 1200RPM, 15.2W". Returns 0 if there are none.
+int format_sensors (const SensorReading *readings, size_t count, char *buffer, size_t size)
+{
+    double values[SENSOR_KIND_COUNT] = {0};
+    int found[SENSOR_KIND_COUNT] = {0};
+    for (size_t i = 0; i < count; i++) {
+        SensorKind kind = (SensorKind)readings[i].kind;
+        if (kind == SENSOR_POWER) {
+            values[kind] += readings[i].value;
+        } else if (!found[kind] || readings[i].value > values[kind]) {
+            values[kind] = readings[i].value;
+        }
+        found[kind] = 1;
+    }
+
+    const char *formats[SENSOR_KIND_COUNT] = {"CPU %.0f°C", "Drive %.0f°C", "Fan %.0fRPM", "%.1fW"};
+    size_t len = 0;
+    buffer[0] = '\0';
+    for (int kind = 0; kind < SENSOR_KIND_COUNT && len < size; kind++) {
+        if (!found[kind]) {
+            continue;
+        }
+        if (len > 0) {
+            len += snprintf(buffer + len, size - len, ", ");
+        }
+        if (len < size) {
+            len += snprintf(buffer + len, size - len, formats[kind], values[kind]);
+        }
+    }
+
+    return len < size ? (int)len : (int)size - 1;
+}
@@ -0,0 +1,312 @@
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <elf.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shell.h"
+#include "config.h"
+#include "io.h"
+
+#define SHELL_CACHE_NAME "shells"
+#define SHELL_CACHE_HEADER "sysgrab shells 2\n"
+#define SHELL_CACHE_ENTRIES 8
+#define SHELL_CACHE_LINE_SIZE 128
+#define SHELL_PATH_SIZE 64
+#define SHELL_STAT_SIZE 512
+#define SHELL_SCAN_LIMIT (4 * 1024 * 1024)
+#define SHELL_MAP_LIMIT (256 * 1024 * 1024)
+#define MAX_ANCESTORS 8
+
+// Strings shells embed right before their version, tried in order. Numeric
+// anchors are generic, so their match only counts if the version starts with a
+// digit and ends the path component, like zsh's "/usr/share/zsh/5.9/functions".
+static const struct {
+    const char *anchor;
+    bool numeric;
+} VERSION_ANCHORS[] = {
+    {"@(#)Bash version ", false},
+    {"@(#)MIRBSD KSH ", false},
+    {"@(#)$Id: Version AJM ", false},
+    {"BusyBox v", false},
+    {"/zsh/", true}
+};
+
+// Process names that are shells
+static const char *SHELL_NAMES[] = {
+    "bash", "rbash", "sh", "dash", "ash", "zsh", "fish", "ksh", "ksh93", "mksh",
+    "oksh", "yash", "tcsh", "csh", "nu", "elvish", "xonsh", "busybox"
+};
+
+// Process names between the shell and the terminal that are not the terminal
+static const char *WRAPPER_NAMES[] = {"su", "sudo", "doas", "login", "env", "script", "nohup", "time", "watch"};
+
+// Function to check if a name is in a list
+static int name_in (const char *name, const char **names, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to read the name and parent of a process from /proc/<pid>/stat,
+// where the name is in parentheses and may itself contain spaces and parentheses
+static int read_process (pid_t pid, char *name, size_t size, pid_t *ppid)
+{
+    char path[SHELL_PATH_SIZE], stat[SHELL_STAT_SIZE];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    if (read_file_buffer(path, stat, sizeof(stat)) <= 0) {
+        return -1;
+    }
+
+    char *open = strchr(stat, '(');
+    char *close = strrchr(stat, ')');
+    int parent;
+    if (open == NULL || close == NULL || close < open || sscanf(close + 1, " %*c %d", &parent) != 1) {
+        return -1;
+    }
+    snprintf(name, size, "%.*s", (int)(close - open - 1), open + 1);
+    *ppid = parent;
+    return 0;
+}
+
+// Function to find the version after the first known anchor in a block of bytes
+int find_shell_version (const char *data, size_t size, char *version, size_t version_size)
+{
+    const char *limit = data + size;
+    for (size_t i = 0; i < sizeof(VERSION_ANCHORS) / sizeof(VERSION_ANCHORS[0]); i++) {
+        const char *anchor = VERSION_ANCHORS[i].anchor;
+        size_t anchor_len = strlen(anchor);
+        const char *found = memmem(data, size, anchor, anchor_len);
+
+        for (; found; found = memmem(found + 1, limit - found - 1, anchor, anchor_len)) {
+            const char *start = found + anchor_len, *end = start;
+            if (VERSION_ANCHORS[i].numeric) {
+                // Dotted digits closed by a slash or the end of the string
+                while (end < limit && (size_t)(end - start) < version_size - 1 && (isdigit((unsigned char)*end) || *end == '.')) {
+                    end++;
+                }
+                if (end == start || !isdigit((unsigned char)*start) || end == limit || (*end != '/' && *end != '\0')) {
+                    continue;
+                }
+            } else {
+                // The version runs until the first character that cannot be part of one, like "5.2.15(1)"
+                while (end < limit && (size_t)(end - start) < version_size - 1 &&
+                       (isalnum((unsigned char)*end) || strchr(".+-_/", *end) != NULL) && *end != '\0') {
+                    end++;
+                }
+                if (end == start) {
+                    break;
+                }
+            }
+
+            snprintf(version, version_size, "%.*s", (int)(end - start), start);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Function to find the read-only data section of a 64-bit ELF image. Returns -1
+// if the image is not one, so the caller scans a bounded prefix instead.
+static int find_rodata (const unsigned char *image, size_t size, size_t *offset, size_t *length)
+{
+    const Elf64_Ehdr *header = (const Elf64_Ehdr *)image;
+    if (size < sizeof(Elf64_Ehdr) || memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+        header->e_ident[EI_CLASS] != ELFCLASS64 || header->e_shentsize != sizeof(Elf64_Shdr) ||
+        header->e_shoff > size || header->e_shnum > (size - header->e_shoff) / sizeof(Elf64_Shdr) ||
+        header->e_shstrndx >= header->e_shnum) {
+        return -1;
+    }
+
+    const Elf64_Shdr *sections = (const Elf64_Shdr *)(image + header->e_shoff);
+    const Elf64_Shdr *names = &sections[header->e_shstrndx];
+    if (names->sh_offset > size || names->sh_size > size - names->sh_offset) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < header->e_shnum; i++) {
+        if (sections[i].sh_name >= names->sh_size || sections[i].sh_type != SHT_PROGBITS) {
+            continue;
+        }
+        const char *name = (const char *)image + names->sh_offset + sections[i].sh_name;
+        if (strncmp(name, ".rodata", names->sh_size - sections[i].sh_name) == 0 &&
+            sections[i].sh_offset <= size && sections[i].sh_size <= size - sections[i].sh_offset) {
+            *offset = sections[i].sh_offset;
+            *length = sections[i].sh_size;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Function to extract the version from a shell binary through a read-only
+// mapping. Only the pages of the read-only data section are touched. Returns 0
+// with the version, 1 if the binary was scanned but has no known anchor, and -1
+// if it could not be scanned.
+static int scan_shell_binary (int fd, size_t size, char *version, size_t version_size)
+{
+    if (size == 0 || size > SHELL_MAP_LIMIT) {
+        return -1;
+    }
+
+    unsigned char *image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    count_syscalls(1);
+    if (image == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    size_t offset = 0, length = size < SHELL_SCAN_LIMIT ? size : SHELL_SCAN_LIMIT;
+    find_rodata(image, size, &offset, &length);
+    int status = find_shell_version((const char *)image + offset, length, version, version_size) == 0 ? 0 : 1;
+
+    munmap(image, size);
+    count_syscalls(1);
+    return status;
+}
+
+// Function to skip the cache header, NULL if the cache was written in another
+// format or by a version of sysgrab that found versions differently
+static const char *cache_entries (const char *cache)
+{
+    size_t header_len = strlen(SHELL_CACHE_HEADER);
+    return cache && strncmp(cache, SHELL_CACHE_HEADER, header_len) == 0 ? cache + header_len : NULL;
+}
+
+// Function to look up the version of a binary in the cache by device, inode and
+// modification time, so it is scanned again only after the binary changes
+static int find_cached_version (const char *cache, const char *key, char *version, size_t version_size)
+{
+    size_t key_len = strlen(key);
+    for (const char *line = cache_entries(cache); line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+        if (strncmp(line, key, key_len) == 0 && line[key_len] == ' ') {
+            const char *value = line + key_len + 1;
+            size_t value_len = strcspn(value, "\n");
+
+            // Binaries without a known version are cached as -
+            if (value_len == 1 && value[0] == '-') {
+                version[0] = '\0';
+            } else {
+                snprintf(version, version_size, "%.*s", (int)value_len, value);
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Function to add a version to the front of the cache, dropping the oldest entries
+static void save_cached_version (const char *cache, const char *key, const char *version)
+{
+    char contents[(SHELL_CACHE_ENTRIES + 1) * SHELL_CACHE_LINE_SIZE];
+    size_t len = snprintf(contents, sizeof(contents), SHELL_CACHE_HEADER "%s %s\n", key, version[0] ? version : "-");
+
+    size_t entries = 1;
+    for (const char *line = cache_entries(cache); line && *line && entries < SHELL_CACHE_ENTRIES; entries++) {
+        const char *next = strchr(line, '\n');
+        size_t line_len = next ? (size_t)(next - line) : strlen(line);
+        if (line_len < SHELL_CACHE_LINE_SIZE && len + line_len + 1 < sizeof(contents)) {
+            len += snprintf(contents + len, sizeof(contents) - len, "%.*s\n", (int)line_len, line);
+        }
+        line = next ? next + 1 : NULL;
+    }
+    save_cache(SHELL_CACHE_NAME, contents);
+}
+
+// Function to get the version of a shell binary, from the cache when it is unchanged
+static void get_shell_version (const char *path, char *version, size_t version_size)
+{
+    version[0] = '\0';
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    count_syscalls(1);
+    if (fd == -1) {
+        return;
+    }
+
+    struct stat st;
+    count_syscalls(1);
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        count_syscalls(1);
+        return;
+    }
+
+    char key[SHELL_CACHE_LINE_SIZE / 2];
+    snprintf(key, sizeof(key), "%llu %llu %lld.%09ld", (unsigned long long)st.st_dev, (unsigned long long)st.st_ino,
+             (long long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+
+    char *cache = load_cache(SHELL_CACHE_NAME);
+    if (find_cached_version(cache, key, version, version_size) != 0) {
+        // Only a completed scan is cached, so a failed mapping is retried next run
+        if (scan_shell_binary(fd, st.st_size, version, version_size) >= 0) {
+            save_cached_version(cache, key, version);
+        }
+    }
+    free(cache);
+
+    close(fd);
+    count_syscalls(1);
+}
+
+// Function to detect the shell and its version without running it. The parent
+// process is used when it is a shell, otherwise the login shell from $SHELL.
+int detect_shell (ShellInfo *shell)
+{
+    char path[SHELL_PATH_SIZE];
+    pid_t parent = getppid(), grandparent;
+    const char *login_shell = getenv("SHELL");
+    const char *login_name = login_shell ? strrchr(login_shell, '/') : NULL;
+    login_name = login_name ? login_name + 1 : login_shell;
+
+    if (read_process(parent, shell->name, sizeof(shell->name), &grandparent) == 0 &&
+        (name_in(shell->name, SHELL_NAMES, sizeof(SHELL_NAMES) / sizeof(SHELL_NAMES[0])) ||
+         (login_name && strcmp(shell->name, login_name) == 0))) {
+        // The exe link opens the binary the shell runs, even if it was replaced since
+        snprintf(path, sizeof(path), "/proc/%d/exe", (int)parent);
+        get_shell_version(path, shell->version, sizeof(shell->version));
+        return 0;
+    }
+
+    if (login_name == NULL || login_name[0] == '\0') {
+        return -1;
+    }
+    snprintf(shell->name, sizeof(shell->name), "%s", login_name);
+    get_shell_version(login_shell, shell->version, sizeof(shell->version));
+    return 0;
+}
+
+// Function to detect the terminal emulator, from TERM_PROGRAM where the terminal
+// sets it, otherwise from the first ancestor that is not a shell or a wrapper
+int detect_terminal (char *name, size_t size)
+{
+    const char *program = getenv("TERM_PROGRAM");
+    if (program && program[0]) {
+        const char *version = getenv("TERM_PROGRAM_VERSION");
+        snprintf(name, size, version && version[0] ? "%s %s" : "%s", program, version);
+        return 0;
+    }
+
+    char comm[SHELL_NAME_SIZE];
+    pid_t pid = getppid(), parent;
+    for (int depth = 0; depth < MAX_ANCESTORS && pid > 1; depth++, pid = parent) {
+        if (read_process(pid, comm, sizeof(comm), &parent) != 0) {
+            return -1;
+        }
+        if (name_in(comm, SHELL_NAMES, sizeof(SHELL_NAMES) / sizeof(SHELL_NAMES[0])) ||
+            name_in(comm, WRAPPER_NAMES, sizeof(WRAPPER_NAMES) / sizeof(WRAPPER_NAMES[0]))) {
+            continue;
+        }
+
+        // Remote sessions have the ssh daemon in place of a terminal
+        snprintf(name, size, "%s", strncmp(comm, "sshd", 4) == 0 ? "ssh" : comm);
+        return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,383 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "sysgrab.h"
+#include "data.h"
+#include "io.h"
+#include "cgroup.h"
+#include "topology.h"
+#include "sensors.h"
+
+#define SYSGRAB_ROOT_SIZE 64
+#define SYSGRAB_BUFFER_SIZE 4096
+
+// Values that are read again after a refresh
+typedef enum {
+    SOURCE_UPTIME,
+    SOURCE_MEMORY,
+    SOURCE_LOAD,
+    SOURCE_PRESSURE_CPU,
+    SOURCE_PRESSURE_MEMORY,
+    SOURCE_PRESSURE_IO,
+    SOURCE_CGROUP,
+    SOURCE_SENSORS,
+    SOURCE_COUNT
+} Source;
+
+// Collection context, values are reread through pread into the context buffers
+struct Sysgrab {
+    int fds[SOURCE_COUNT];
+    bool opened[SOURCE_COUNT];
+    bool fresh[SOURCE_COUNT];
+    bool cached[DATA_POINT_COUNT];
+    bool has_topology;
+    bool has_sensors;
+    double uptime;
+    MemInfo memory;
+    double load[3];
+    Pressure pressure[PRESSURE_COUNT];
+    CgroupStats cgroup;
+    char cgroup_path[PATH_MAX];
+    Sensors sensors;
+    SensorReading readings[MAX_SENSORS];
+    int reading_count;
+    Topology topology;
+    IoBackend backend;
+    Prefetch prefetch;
+    char buffer[SYSGRAB_BUFFER_SIZE];
+    char values[DATA_POINT_COUNT][INFO_BUFFER_SIZE];
+};
+
+// Files behind the sources that are kept open, the cgroup directory is found at runtime
+static const char *SOURCE_PATHS[SOURCE_COUNT] = {
+    "/proc/uptime",
+    "/proc/meminfo",
+    "/proc/loadavg",
+    "/proc/pressure/cpu",
+    "/proc/pressure/memory",
+    "/proc/pressure/io",
+    NULL,
+    NULL
+};
+
+// Function to open the cgroup directory of this process
+static int open_own_cgroup (Sysgrab *sysgrab)
+{
+    char root[SYSGRAB_ROOT_SIZE], dir_path[PATH_MAX + SYSGRAB_ROOT_SIZE];
+    if (find_cgroup_root(root, sizeof(root)) != 0 || get_own_cgroup(sysgrab->cgroup_path, sizeof(sysgrab->cgroup_path)) != 0) {
+        return -1;
+    }
+
+    snprintf(dir_path, sizeof(dir_path), "%s%s", root, sysgrab->cgroup_path);
+    count_syscalls(1);
+    return open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+// Function to open a collection context
+Sysgrab *sysgrab_open (void)
+{
+    Sysgrab *sysgrab = calloc(1, sizeof(Sysgrab));
+    if (sysgrab == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+
+    // Sources are opened on first use, so a layout only pays for the values it shows
+    for (int source = 0; source < SOURCE_COUNT; source++) {
+        sysgrab->fds[source] = -1;
+    }
+    sysgrab->cgroup.path = sysgrab->cgroup_path;
+
+    // Sensors are resolved once on first use, later samples only read their inputs
+    for (size_t i = 0; i < MAX_SENSORS; i++) {
+        sysgrab->sensors.fds[i] = -1;
+    }
+
+    return sysgrab;
+}
+
+// Function to mark every changing value as stale, so the next access rereads it
+void sysgrab_refresh (Sysgrab *sysgrab)
+{
+    memset(sysgrab->fresh, 0, sizeof(sysgrab->fresh));
+    clear_prefetch(&sysgrab->prefetch);
+}
+
+// Function to close every descriptor and free the context
+void sysgrab_close (Sysgrab *sysgrab)
+{
+    if (sysgrab == NULL) {
+        return;
+    }
+    for (int source = 0; source < SOURCE_COUNT; source++) {
+        if (sysgrab->fds[source] != -1) {
+            close(sysgrab->fds[source]);
+            count_syscalls(1);
+        }
+    }
+    close_sensors(&sysgrab->sensors);
+    free(sysgrab);
+}
+
+// Function to select the backend the context reads batches with, io_uring is opt-in
+void sysgrab_set_backend (Sysgrab *sysgrab, SysgrabBackend backend)
+{
+    sysgrab->backend = (IoBackend)backend;
+}
+
+// Function to read the files behind the given datapoints in one batch, so formatting
+// them does not go to disk again until the next refresh
+void sysgrab_prefetch (Sysgrab *sysgrab, const SysgrabDataPoint *dps, size_t count)
+{
+    DataPoint points[DATA_POINT_COUNT];
+    size_t point_count = 0;
+    for (size_t i = 0; i < count && point_count < DATA_POINT_COUNT; i++) {
+        points[point_count++] = (DataPoint)dps[i];
+    }
+
+    // A context that fell back to plain reads does not retry io_uring
+    sysgrab->backend = prefetch_info(&sysgrab->prefetch, sysgrab->backend, points, point_count);
+}
+
+// Function to open the descriptor behind a source once, -1 if it is not available
+static int open_source (Sysgrab *sysgrab, Source source)
+{
+    if (!sysgrab->opened[source]) {
+        if (source == SOURCE_CGROUP) {
+            sysgrab->fds[source] = open_own_cgroup(sysgrab);
+        } else if (SOURCE_PATHS[source]) {
+            sysgrab->fds[source] = open(SOURCE_PATHS[source], O_RDONLY | O_CLOEXEC);
+            count_syscalls(1);
+        }
+        sysgrab->opened[source] = true;
+    }
+    return sysgrab->fds[source];
+}
+
+// Function to reread an open proc file into the context buffer
+static int pread_source (Sysgrab *sysgrab, Source source)
+{
+    if (open_source(sysgrab, source) == -1) {
+        return -1;
+    }
+
+    // Proc files are generated in full on every read from offset zero
+    ssize_t len = pread(sysgrab->fds[source], sysgrab->buffer, sizeof(sysgrab->buffer) - 1, 0);
+    count_syscalls(1);
+    if (len <= 0) {
+        return -1;
+    }
+    sysgrab->buffer[len] = '\0';
+    return 0;
+}
+
+// Function to reread a source unless it is already fresh since the last refresh
+static int update_source (Sysgrab *sysgrab, Source source)
+{
+    if (sysgrab->fresh[source]) {
+        return 0;
+    }
+
+    int status = -1;
+    switch (source) {
+        case SOURCE_UPTIME:
+            status = pread_source(sysgrab, source) == 0 ? parse_uptime(sysgrab->buffer, &sysgrab->uptime) : -1;
+            break;
+        case SOURCE_MEMORY:
+            status = pread_source(sysgrab, source) == 0 ? parse_meminfo(sysgrab->buffer, &sysgrab->memory) : -1;
+            break;
+        case SOURCE_LOAD:
+            status = pread_source(sysgrab, source) == 0 ? parse_loadavg(sysgrab->buffer, sysgrab->load) : -1;
+            break;
+        case SOURCE_PRESSURE_CPU:
+        case SOURCE_PRESSURE_MEMORY:
+        case SOURCE_PRESSURE_IO: {
+            Pressure *pressure = &sysgrab->pressure[source - SOURCE_PRESSURE_CPU];
+            if (pread_source(sysgrab, source) == 0) {
+                status = parse_pressure(sysgrab->buffer, pressure);
+            } else {
+                pressure->avg10 = pressure->avg60 = pressure->avg300 = -1;
+            }
+            break;
+        }
+        case SOURCE_CGROUP:
+            if (open_source(sysgrab, source) != -1) {
+                status = read_cgroup_stats(sysgrab->fds[source], &sysgrab->cgroup);
+                sysgrab->cgroup.path = sysgrab->cgroup_path;
+            }
+            break;
+        case SOURCE_SENSORS:
+            // The inputs are resolved on first use, so contexts that never show sensors skip the scan
+            if (!sysgrab->has_sensors) {
+                open_sensors(&sysgrab->sensors);
+                sysgrab->has_sensors = true;
+            }
+            sysgrab->reading_count = sample_sensors(&sysgrab->sensors, sysgrab->readings, MAX_SENSORS);
+            status = sysgrab->reading_count > 0 ? 0 : -1;
+            break;
+        default:
+            break;
+    }
+
+    if (status == 0) {
+        sysgrab->fresh[source] = true;
+    }
+    return status;
+}
+
+// Function to get the system uptime in seconds
+int sysgrab_get_uptime (Sysgrab *sysgrab, double *uptime)
+{
+    if (update_source(sysgrab, SOURCE_UPTIME) != 0) {
+        return -1;
+    }
+    *uptime = sysgrab->uptime;
+    return 0;
+}
+
+// Function to get the memory components, sizes in kB and hugepages in pages
+int sysgrab_get_memory (Sysgrab *sysgrab, MemInfo *mem)
+{
+    if (update_source(sysgrab, SOURCE_MEMORY) != 0) {
+        return -1;
+    }
+    *mem = sysgrab->memory;
+    return 0;
+}
+
+// Function to get the 1, 5 and 15 minute load averages
+int sysgrab_get_load (Sysgrab *sysgrab, double load[3])
+{
+    if (update_source(sysgrab, SOURCE_LOAD) != 0) {
+        return -1;
+    }
+    memcpy(load, sysgrab->load, sizeof(sysgrab->load));
+    return 0;
+}
+
+// Function to get the pressure stall information of every resource, with negative
+// averages where it is not available. Returns -1 if none is available.
+int sysgrab_get_pressure (Sysgrab *sysgrab, Pressure pressure[PRESSURE_COUNT])
+{
+    int available = 0;
+    for (int resource = 0; resource < PRESSURE_COUNT; resource++) {
+        if (update_source(sysgrab, SOURCE_PRESSURE_CPU + resource) == 0) {
+            available++;
+        }
+        pressure[resource] = sysgrab->pressure[resource];
+    }
+    return available > 0 ? 0 : -1;
+}
+
+// Function to get the usage of the cgroup of this process, the path is owned by the context
+int sysgrab_get_cgroup (Sysgrab *sysgrab, CgroupStats *stats)
+{
+    if (update_source(sysgrab, SOURCE_CGROUP) != 0) {
+        return -1;
+    }
+    *stats = sysgrab->cgroup;
+    return 0;
+}
+
+// Function to get the sensor readings, owned by the context. Returns the number of readings.
+int sysgrab_get_sensors (Sysgrab *sysgrab, const SensorReading **readings)
+{
+    if (update_source(sysgrab, SOURCE_SENSORS) != 0) {
+        return -1;
+    }
+    *readings = sysgrab->readings;
+    return sysgrab->reading_count;
+}
+
+// Function to get the CPU layout, read once per context
+int sysgrab_get_topology (Sysgrab *sysgrab, Topology *topology)
+{
+    if (!sysgrab->has_topology) {
+        if (read_topology(&sysgrab->topology) != 0) {
+            return -1;
+        }
+        sysgrab->has_topology = true;
+    }
+    *topology = sysgrab->topology;
+    return 0;
+}
+
+// Function to get the formatted string for a datapoint. The string is owned by the
+// context and stays valid until the same datapoint is requested again. Returns NULL
+// if the datapoint is not available.
+const char *sysgrab_get_string (Sysgrab *sysgrab, SysgrabDataPoint field)
+{
+    DataPoint dp = (DataPoint)field;
+    if (dp < 0 || dp >= DATA_POINT_COUNT) {
+        return NULL;
+    }
+    char *value = sysgrab->values[dp];
+    int len = -1;
+
+    switch (dp) {
+        case UPTIME: {
+            double uptime;
+            if (sysgrab_get_uptime(sysgrab, &uptime) == 0) {
+                len = format_uptime(uptime, value, INFO_BUFFER_SIZE);
+            }
+            break;
+        }
+        case MEMORY: {
+            MemInfo mem;
+            if (sysgrab_get_memory(sysgrab, &mem) == 0) {
+                len = format_memory(&mem, value, INFO_BUFFER_SIZE);
+            }
+            break;
+        }
+        case LOAD: {
+            double load[3];
+            if (sysgrab_get_load(sysgrab, load) == 0) {
+                len = format_load(load, value, INFO_BUFFER_SIZE);
+            }
+            break;
+        }
+        case PRESSURE: {
+            Pressure pressure[PRESSURE_COUNT];
+            if (sysgrab_get_pressure(sysgrab, pressure) == 0) {
+                len = format_pressure(pressure, value, INFO_BUFFER_SIZE);
+            }
+            break;
+        }
+        case CGROUP: {
+            CgroupStats stats;
+            if (sysgrab_get_cgroup(sysgrab, &stats) == 0) {
+                len = format_cgroup(&stats, value, INFO_BUFFER_SIZE);
+            }
+            break;
+        }
+        case SENSORS: {
+            const SensorReading *readings;
+            int count = sysgrab_get_sensors(sysgrab, &readings);
+            if (count > 0) {
+                len = format_sensors(readings, count, value, INFO_BUFFER_SIZE);
+            }
+            break;
+        }
+        case TOPOLOGY: {
+            Topology topology;
+            if (sysgrab_get_topology(sysgrab, &topology) == 0) {
+                len = format_topology(&topology, value, INFO_BUFFER_SIZE);
+            }
+            break;
+        }
+        default:
+            // Everything else cannot change while running, so it is formatted once
+            if (!sysgrab->cached[dp]) {
+                if (format_info(&sysgrab->prefetch, dp, value, INFO_BUFFER_SIZE) < 0) {
+                    value[0] = '\0';
+                }
+                sysgrab->cached[dp] = true;
+            }
+            len = (int)strlen(value);
+            break;
+    }
+
+    return len > 0 ? value : NULL;
+}
@@ -0,0 +1,256 @@
+#include "template.h"
+
+#define TEMPLATE_LINE_EXTRA 32
+#define TEMPLATE_LINE_KEY "line"
+#define TEMPLATE_MISSING "not found"
+
+// Names usable between braces in a template line
+static const struct {
+    const char *name;
+    TemplateOpCode code;
+    DataPoint field;
+} TEMPLATE_NAMES[] = {
+    {"accent", OP_ACCENT_COLOR, 0},
+    {"base", OP_BASE_COLOR, 0},
+    {"reset", OP_RESET, 0},
+    {"dashes", OP_DASHES, 0},
+    {"username", OP_FIELD, USERNAME},
+    {"hostname", OP_FIELD, HOSTNAME},
+    {"os", OP_FIELD, OS},
+    {"architecture", OP_FIELD, ARCHITECTURE},
+    {"kernel", OP_FIELD, KERNEL},
+    {"computer", OP_FIELD, COMPUTER},
+    {"shell", OP_FIELD, SHELL},
+    {"terminal", OP_FIELD, TERMINAL},
+    {"uptime", OP_FIELD, UPTIME},
+    {"cpu", OP_FIELD, CPU},
+    {"topology", OP_FIELD, TOPOLOGY},
+    {"memory", OP_FIELD, MEMORY},
+    {"load", OP_FIELD, LOAD},
+    {"pressure", OP_FIELD, PRESSURE},
+    {"cgroup", OP_FIELD, CGROUP},
+    {"sensors", OP_FIELD, SENSORS},
+    {"devices", OP_FIELD, DEVICES}
+};
+
+// Function to append an operation, merging a literal into the literal before it
+static void add_op (Template *template, TemplateOpCode code, DataPoint field, uint32_t offset, size_t length)
+{
+    if (code == OP_LITERAL) {
+        if (length == 0) {
+            return;
+        }
+        TemplateOp *last = template->op_count ? &template->ops[template->op_count - 1] : NULL;
+        if (last && last->code == OP_LITERAL && last->offset + last->length == offset && last->length + length <= UINT16_MAX) {
+            last->length += length;
+            return;
+        }
+    }
+
+    TemplateOp *op = &template->ops[template->op_count++];
+    op->code = code;
+    op->field = field;
+    op->offset = offset;
+    op->length = length;
+}
+
+// Function to look up a name between braces, -1 if it is not known
+static int find_name (const char *name, size_t length)
+{
+    for (size_t i = 0; i < sizeof(TEMPLATE_NAMES) / sizeof(TEMPLATE_NAMES[0]); i++) {
+        if (strlen(TEMPLATE_NAMES[i].name) == length && strncmp(TEMPLATE_NAMES[i].name, name, length) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Function to compile template lines into a list of literal, color and field
+// operations. Literal text is copied once into a shared pool, unknown names are
+// kept as literal text.
+Template *compile_template (const char **lines, size_t line_count)
+{
+    // Every character can at most start one operation, plus one end per line
+    size_t total = 0;
+    for (size_t i = 0; i < line_count; i++) {
+        total += strlen(lines[i]);
+    }
+
+    Template *template = calloc(1, sizeof(Template));
+    if (template == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+    template->ops = malloc((total + line_count) * sizeof(TemplateOp));
+    template->literals = malloc(total + 1);
+    if (template->ops == NULL || template->literals == NULL) {
+        perror("malloc");
+        free_template(template);
+        return NULL;
+    }
+    template->line_count = line_count;
+
+    for (size_t i = 0; i < line_count; i++) {
+        const char *cursor = lines[i];
+        while (*cursor) {
+            const char *open = strchr(cursor, '{');
+            const char *close = open ? strchr(open, '}') : NULL;
+            size_t text_len = open && close ? (size_t)(open - cursor) : strlen(cursor);
+
+            // Copy the text before the next placeholder into the pool
+            memcpy(template->literals + template->literals_size, cursor, text_len);
+            add_op(template, OP_LITERAL, 0, template->literals_size, text_len);
+            template->literals_size += text_len;
+            cursor += text_len;
+            if (!(open && close)) {
+                break;
+            }
+
+            int index = find_name(open + 1, close - open - 1);
+            if (index < 0) {
+                // Keep unknown names as text so typos are visible in the output
+                fprintf(stderr, "Unknown template name: %.*s\n", (int)(close - open + 1), open);
+                size_t name_len = close - open + 1;
+                memcpy(template->literals + template->literals_size, open, name_len);
+                add_op(template, OP_LITERAL, 0, template->literals_size, name_len);
+                template->literals_size += name_len;
+            } else {
+                add_op(template, TEMPLATE_NAMES[index].code, TEMPLATE_NAMES[index].field, 0, 0);
+                if (TEMPLATE_NAMES[index].code == OP_FIELD) {
+                    template->fields |= 1u << TEMPLATE_NAMES[index].field;
+                } else if (TEMPLATE_NAMES[index].code == OP_DASHES) {
+                    template->fields |= (1u << USERNAME) | (1u << HOSTNAME);
+                }
+            }
+            cursor = close + 1;
+        }
+        add_op(template, OP_END_LINE, 0, 0, 0);
+    }
+    template->literals[template->literals_size] = '\0';
+
+    return template;
+}
+
+// Function to compile the line entries of a config in order, NULL if there are none.
+// This runs on every start instead of going through a cache like the sensor, shell
+// and PCI lookups, since compiling a few short lines costs less than opening,
+// statting and validating a cache file against the config.
+Template *compile_config_template (const Config *config, size_t config_count)
+{
+    const char **lines = malloc((config_count + 1) * sizeof(char *));
+    if (lines == NULL) {
+        perror("malloc");
+        return NULL;
+    }
+
+    size_t line_count = 0;
+    for (size_t i = 0; i < config_count; i++) {
+        if (strcmp(config[i].name, TEMPLATE_LINE_KEY) == 0) {
+            lines[line_count++] = config[i].value;
+        }
+    }
+
+    Template *template = line_count > 0 ? compile_template(lines, line_count) : NULL;
+    free(lines);
+    return template;
+}
+
+// Function to free a compiled template
+void free_template (Template *template)
+{
+    if (template == NULL) {
+        return;
+    }
+    free(template->ops);
+    free(template->literals);
+    free(template);
+}
+
+// Function to render a template with the art to its left into one buffer. Colors
+// come from precomputed escapes and are only written where they change. Only the
+// fields the template references are collected.
+char *render_template (const Template *template, Sysgrab *sysgrab, const Color *base_color, const Color *accent_color,
+                       char **art, size_t art_line_count, const ArtPaint *paint)
+{
+    PaintColor base, accent;
+    make_paint_color(base_color, paint->mode, &base);
+    make_paint_color(accent_color, paint->mode, &accent);
+
+    // Bound the output from the art, the literals and the largest value of each operation
+    size_t line_count = template->line_count > art_line_count ? template->line_count : art_line_count;
+    size_t size = line_count * ((paint->width + 3) * (PAINT_ESCAPE_SIZE + 1) + TEMPLATE_LINE_EXTRA) + template->literals_size + 1;
+    for (size_t i = 0; i < template->op_count; i++) {
+        size += template->ops[i].code == OP_DASHES ? 2 * INFO_BUFFER_SIZE : INFO_BUFFER_SIZE;
+    }
+
+    char *output = malloc(size);
+    if (output == NULL) {
+        perror("malloc");
+        return NULL;
+    }
+
+    size_t len = 0, line = 0, i = 0;
+    for (; line < template->line_count; line++, i++) {
+        // Every line starts with its line of art, then continues in the accent color
+        uint32_t current = PAINT_NO_COLOR;
+        const PaintColor *pending = &accent;
+        if (art != NULL) {
+            len += paint_art_line(paint, line < art_line_count ? art[line] : "", line, output + len, &current);
+        }
+
+        for (; i < template->op_count && template->ops[i].code != OP_END_LINE; i++) {
+            const TemplateOp *op = &template->ops[i];
+
+            // Colors are only written right before text, so back to back switches cost nothing
+            if (pending && (op->code == OP_LITERAL || op->code == OP_FIELD || op->code == OP_DASHES)) {
+                len += write_paint_color(output + len, pending, &current);
+                pending = NULL;
+            }
+
+            switch (op->code) {
+                case OP_LITERAL:
+                    memcpy(output + len, template->literals + op->offset, op->length);
+                    len += op->length;
+                    break;
+                case OP_ACCENT_COLOR:
+                    pending = &accent;
+                    break;
+                case OP_BASE_COLOR:
+                    pending = &base;
+                    break;
+                case OP_RESET:
+                    len += sprintf(output + len, "\033[0m");
+                    current = PAINT_NO_COLOR;
+                    pending = NULL;
+                    break;
+                case OP_FIELD: {
+                    const char *value = sysgrab_get_string(sysgrab, op->field);
+                    len += sprintf(output + len, "%s", value ? value : TEMPLATE_MISSING);
+                    break;
+                }
+                case OP_DASHES: {
+                    // A rule as long as the user@host title
+                    const char *username = sysgrab_get_string(sysgrab, SYSGRAB_USERNAME);
+                    const char *hostname = sysgrab_get_string(sysgrab, SYSGRAB_HOSTNAME);
+                    size_t dashes = (username ? strlen(username) : 0) + 1 + (hostname ? strlen(hostname) : 0);
+                    memset(output + len, '-', dashes);
+                    len += dashes;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        len += sprintf(output + len, "\033[0m\n");
+    }
+
+    // Print remaining lines of art
+    for (; art != NULL && line < art_line_count; line++) {
+        uint32_t current = PAINT_NO_COLOR;
+        len += paint_art_line(paint, art[line], line, output + len, &current);
+        len += sprintf(output + len, "\033[0m\n");
+    }
+    output[len] = '\0';
+
+    return output;
+}
@@ -0,0 +1,290 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "topology.h"
+#include "io.h"
+
+#define TOPOLOGY_BUFFER_SIZE 4096
+#define TOPOLOGY_PATH_SIZE 128
+#define TOPOLOGY_MAX_CACHES 16
+#define CPU_SYSFS_PATH "/sys/devices/system/cpu"
+
+// Function to set bits first to last in a set, a word at a time
+static void set_range (CpuSet *set, unsigned first, unsigned last)
+{
+    unsigned first_word = first / 64, last_word = last / 64;
+    uint64_t first_mask = ~0ULL << (first % 64);
+    uint64_t last_mask = ~0ULL >> (63 - last % 64);
+
+    if (first_word == last_word) {
+        set->bits[first_word] |= first_mask & last_mask;
+        return;
+    }
+    set->bits[first_word] |= first_mask;
+    for (unsigned w = first_word + 1; w < last_word; w++) {
+        set->bits[w] = ~0ULL;
+    }
+    set->bits[last_word] |= last_mask;
+}
+
+// Function to parse an unsigned decimal number, advancing the cursor
+static unsigned parse_number (const char **cursor)
+{
+    unsigned value = 0;
+    while (**cursor >= '0' && **cursor <= '9') {
+        value = value * 10 + (unsigned)(**cursor - '0');
+        (*cursor)++;
+    }
+    return value;
+}
+
+// Function to parse a cpulist such as "0-3,8,10-11" into a set
+int parse_cpulist (const char *list, CpuSet *set)
+{
+    memset(set, 0, sizeof(*set));
+    const char *cursor = list;
+
+    while (*cursor >= '0' && *cursor <= '9') {
+        unsigned first = parse_number(&cursor), last = first;
+        if (*cursor == '-') {
+            cursor++;
+            last = parse_number(&cursor);
+        }
+        if (last < first || last >= CPUSET_MAX_CPUS) {
+            return -1;
+        }
+        set_range(set, first, last);
+
+        if (*cursor != ',') {
+            break;
+        }
+        cursor++;
+    }
+
+    return (*cursor == '\0' || *cursor == '\n') ? 0 : -1;
+}
+
+// Function to parse a cpumask such as "ffffffff,0000000f" into a set. Groups of
+// 32 bits are separated by commas, most significant group first.
+int parse_cpumask (const char *mask, CpuSet *set)
+{
+    memset(set, 0, sizeof(*set));
+
+    // Walk hex digits from the least significant end
+    size_t len = strcspn(mask, "\n");
+    unsigned bit = 0;
+    for (size_t i = len; i > 0; i--) {
+        char c = mask[i - 1];
+        unsigned nibble;
+        if (c == ',') {
+            continue;
+        } else if (c >= '0' && c <= '9') {
+            nibble = (unsigned)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = (unsigned)(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = (unsigned)(c - 'A' + 10);
+        } else {
+            return -1;
+        }
+
+        if (nibble && bit >= CPUSET_MAX_CPUS) {
+            return -1;
+        }
+        if (nibble) {
+            set->bits[bit / 64] |= (uint64_t)nibble << (bit % 64);
+        }
+        bit += 4;
+    }
+    return 0;
+}
+
+// Function to count the CPUs in a set
+int cpuset_count (const CpuSet *set)
+{
+    int count = 0;
+    for (int w = 0; w < CPUSET_WORDS; w++) {
+        count += __builtin_popcountll(set->bits[w]);
+    }
+    return count;
+}
+
+// Function to find the first CPU in a set at or after cpu, or -1
+int cpuset_next (const CpuSet *set, int cpu)
+{
+    if (cpu < 0 || cpu >= CPUSET_MAX_CPUS) {
+        return -1;
+    }
+
+    int w = cpu / 64;
+    uint64_t word = set->bits[w] & (~0ULL << (cpu % 64));
+    while (word == 0) {
+        if (++w == CPUSET_WORDS) {
+            return -1;
+        }
+        word = set->bits[w];
+    }
+    return w * 64 + __builtin_ctzll(word);
+}
+
+// Function to read a cpulist file relative to the cpu sysfs directory, falling
+// back to the cpumask file of the same name without the _list suffix
+static int read_cpulist_at (int dirfd, const char *path, CpuSet *set)
+{
+    char buffer[TOPOLOGY_BUFFER_SIZE];
+    if (read_file_at(dirfd, path, buffer, sizeof(buffer)) > 0) {
+        return parse_cpulist(buffer, set);
+    }
+
+    size_t len = strlen(path);
+    if (len < 5 || len >= TOPOLOGY_PATH_SIZE || strcmp(path + len - 5, "_list") != 0) {
+        return -1;
+    }
+    char mask_path[TOPOLOGY_PATH_SIZE];
+    memcpy(mask_path, path, len - 5);
+    mask_path[len - 5] = '\0';
+    if (read_file_at(dirfd, mask_path, buffer, sizeof(buffer)) <= 0) {
+        return -1;
+    }
+    return parse_cpumask(buffer, set);
+}
+
+// Function to count the groups covering a set of CPUs, reading the group of
+// one uncovered CPU at a time so each group costs a single read
+static int count_groups (int dirfd, const CpuSet *cpus, const char *format)
+{
+    CpuSet covered, group;
+    char path[TOPOLOGY_PATH_SIZE];
+    int groups = 0;
+
+    memset(&covered, 0, sizeof(covered));
+    for (int cpu = cpuset_next(cpus, 0); cpu >= 0; cpu = cpuset_next(cpus, cpu + 1)) {
+        if (covered.bits[cpu / 64] & (1ULL << (cpu % 64))) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), format, cpu);
+        if (read_cpulist_at(dirfd, path, &group) != 0) {
+            return -1;
+        }
+        for (int w = 0; w < CPUSET_WORDS; w++) {
+            covered.bits[w] |= group.bits[w];
+        }
+        // Make sure the loop always advances even if the CPU is missing from its own group
+        covered.bits[cpu / 64] |= 1ULL << (cpu % 64);
+        groups++;
+    }
+    return groups;
+}
+
+// Function to count cores as the distinct groups of hardware threads among the
+// online CPUs. Dividing by one CPU's SMT width would be wrong when some siblings
+// are offline or when core types differ in width, as on hybrid parts.
+static int count_cores (int dirfd, const CpuSet *online)
+{
+    int cores = count_groups(dirfd, online, "cpu%d/topology/core_cpus_list");
+    if (cores < 0) {
+        // Kernels before 5.5 only have the older name
+        cores = count_groups(dirfd, online, "cpu%d/topology/thread_siblings_list");
+    }
+    return cores;
+}
+
+// Function to find the last level cache of a CPU and count its instances
+static void read_last_level_cache (int dirfd, const CpuSet *online, Topology *topology)
+{
+    char buffer[TOPOLOGY_BUFFER_SIZE];
+    char path[TOPOLOGY_PATH_SIZE];
+    int first = cpuset_next(online, 0);
+    int llc_index = -1;
+
+    for (int index = 0; index < TOPOLOGY_MAX_CACHES; index++) {
+        snprintf(path, sizeof(path), "cpu%d/cache/index%d/level", first, index);
+        if (read_file_at(dirfd, path, buffer, sizeof(buffer)) <= 0) {
+            break;
+        }
+        int level = atoi(buffer);
+
+        // Instruction caches never form the last level
+        snprintf(path, sizeof(path), "cpu%d/cache/index%d/type", first, index);
+        if (read_file_at(dirfd, path, buffer, sizeof(buffer)) <= 0 || strncmp(buffer, "Instruction", 11) == 0) {
+            continue;
+        }
+        if (level > topology->cache_level) {
+            snprintf(path, sizeof(path), "cpu%d/cache/index%d/size", first, index);
+            if (read_file_at(dirfd, path, buffer, sizeof(buffer)) <= 0) {
+                continue;
+            }
+
+            // Sizes are given in kB with a K suffix
+            long size = strtol(buffer, NULL, 10);
+            if (strchr(buffer, 'M')) {
+                size *= 1024;
+            }
+            topology->cache_level = level;
+            topology->cache_size_kib = size;
+            llc_index = index;
+        }
+    }
+
+    if (llc_index >= 0) {
+        snprintf(path, sizeof(path), "cpu%%d/cache/index%d/shared_cpu_list", llc_index);
+        topology->cache_instances = count_groups(dirfd, online, path);
+    }
+}
+
+// Function to read sockets, cores, threads, last level cache and NUMA nodes from sysfs
+int read_topology (Topology *topology)
+{
+    char buffer[TOPOLOGY_BUFFER_SIZE];
+    CpuSet online, nodes;
+
+    memset(topology, 0, sizeof(*topology));
+    int dirfd = open(CPU_SYSFS_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd == -1) {
+        return -1;
+    }
+    if (read_cpulist_at(dirfd, "online", &online) != 0 || cpuset_count(&online) == 0) {
+        close(dirfd);
+        return -1;
+    }
+
+    topology->threads = cpuset_count(&online);
+    topology->sockets = count_groups(dirfd, &online, "cpu%d/topology/package_cpus_list");
+    if (topology->sockets < 0) {
+        // Kernels before 5.5 only have the older name
+        topology->sockets = count_groups(dirfd, &online, "cpu%d/topology/core_siblings_list");
+    }
+    topology->cores = count_cores(dirfd, &online);
+    read_last_level_cache(dirfd, &online, topology);
+    close(dirfd);
+
+    // Machines without NUMA support expose no node directory
+    topology->numa_nodes = 1;
+    if (read_file_buffer("/sys/devices/system/node/online", buffer, sizeof(buffer)) > 0 && parse_cpulist(buffer, &nodes) == 0) {
+        topology->numa_nodes = cpuset_count(&nodes);
+    }
+
+    return 0;
+}
+
+// Function to format a topology as e.g. "2S/64C/128T, L3 2×256MiB, 2 NUMA nodes"
+int format_topology (const Topology *topology, char *buffer, size_t size)
+{
+    int len = snprintf(buffer, size, "%dS/%dC/%dT", topology->sockets, topology->cores, topology->threads);
+
+    if (topology->cache_level > 0 && topology->cache_instances > 0 && len >= 0 && (size_t)len < size) {
+        long cache_size = topology->cache_size_kib;
+        const char *unit = "KiB";
+        if (cache_size >= 1024 && cache_size % 1024 == 0) {
+            cache_size /= 1024;
+            unit = "MiB";
+        }
+        len += snprintf(buffer + len, size - len, ", L%d %d×%ld%s", topology->cache_level, topology->cache_instances, cache_size, unit);
+    }
+
+    if (len >= 0 && (size_t)len < size) {
+        len += snprintf(buffer + len, size - len, ", %d NUMA node%s", topology->numa_nodes, topology->numa_nodes == 1 ? "" : "s");
+    }
+    return len;
+}